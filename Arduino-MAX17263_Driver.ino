@@ -11,36 +11,50 @@ MAX17263 Single/Multi-Cell Fuel Gauge with ModelGauge m5 EZ and Integrated LED C
 #include <Wire.h>
 #include <Albert.h>
 
+// LED fields the sketch writes, setLEDCfg1/2() keep the other bits, verifyConfigImage() checks these
+const byte LEDTimer = 2; // 0.6s because of T1 overheath
+const bool LChg = 0; // default=1, no LEDs on while charging because of T1 overheath
+const byte NBARS = 10; // using larger LED resistors may not achieve correct auto-count upon start up
+const uint16_t ledCfg1Mask = MAX17263LedCfg1LEDTimer::mask | MAX17263LedCfg1LChg::mask | MAX17263LedCfg1NBARS::mask;
+const uint16_t ledCfg1Bits = MAX17263LedCfg1LEDTimer::bits(LEDTimer) | MAX17263LedCfg1LChg::bits(LChg) | MAX17263LedCfg1NBARS::bits(NBARS);
+const bool EnAutoLEDCnt = 0; // 1->0 using larger LED resistors may not achieve correct auto-count upon start up
+const bool EBlink = 1; // 0->1 blink lowest LED when empty is detected
+const byte Brightness = 31; // max 31
+const uint16_t ledCfg2Mask = MAX17263LedCfg2EnAutoLEDCnt::mask | MAX17263LedCfg2EBlink::mask | MAX17263LedCfg2Brightness::mask;
+const uint16_t ledCfg2Bits = MAX17263LedCfg2EnAutoLEDCnt::bits(EnAutoLEDCnt) | MAX17263LedCfg2EBlink::bits(EBlink) | MAX17263LedCfg2Brightness::bits(Brightness);
+
 // Public Methods
 
 bool MAX17263::batteryPresent()
-{ bool bst = getStatus() & 0x0008; // check battery status Bst flag = 0, UG6597 page 33 
+{ bool bst = getStatus() & MAX17263StatusBSt::mask; // check battery status Bst flag = 0, UG6597 page 33 
   Serial << F("\nBattery present: ") << !bst << " status bin: " << _BIN(getStatus()) << " " << millis();
   return(!bst); 
 }
 
 bool MAX17263::powerOnResetEvent()
-{ bool por = getStatus() & 0x0002; // check POR bit
+{ bool por = getStatus() & MAX17263StatusPOR::mask; // check POR bit
   Serial << F("\nPower On Reset event: ") << por << " " << millis();
   return(por);  
 }
 
-void MAX17263::initialize()
-{ waitForDNRdataNotReady(); // Step 1
-  storeHibernateCFG();
+bool MAX17263::initialize() // POR is only cleared when every step succeeded, so a failed initialize() is retried
+{ fault = faultNone;
+  if(!waitForDNRdataNotReady()) fault = faultDataNotReady; // Step 1
+  else if(!storeHibernateCFG()) fault = faultBus; // a garbage HibCfg would be restored at the end
+  if(fault) return 0;
   exitHibernate(); // Step 2: Initialize Configuration 
   setEZconfig(); // Step 2.1 EZ Config (No INI file is needed):
   restoreHibernateCFG();
-  clearPORpowerOnReset(); // Step 3: Initialization Complete 
-  setLEDCfg1();
-  setLEDCfg2();
+  if(!fault && !(setLEDCfg1() && setLEDCfg2())) fault = faultBus;
+  if(!fault && !verifyConfigImage()) fault = faultConfig; // one readback of all written registers, instead of a readback after every write
+  if(!fault && !clearPORpowerOnReset()) fault = faultBus; // Step 3: Initialization Complete 
+  return fault == faultNone;
 }
 
 void MAX17263::setEZconfig()
 { calcMultipliers(rSense);    
-  setDesignCap_mAh(designCap_mAh); // max 163000mAh 
-  refreshModelCFG(r100, vChg, modelID);
-  waitforModelCFGrefreshReady();
+  if(!setDesignCap_mAh(designCap_mAh) || !refreshModelCFG(r100, vChg, modelID)) fault = faultBus; // max 163000mAh 
+  else if(!waitforModelCFGrefreshReady()) fault = faultRefresh;
   /* setIchgTerm(ichgTerm); // leave default */
   /* setVEmpty(vEmpty); // leave default */
 }
@@ -84,30 +98,51 @@ uint16_t MAX17263::getStatus() // MAX1726x-ModelGauge-m5-EZ-user-guide
 { return readReg16Bit(regStatus); 
 }
 
-void MAX17263::writeReg16Bit(byte reg, uint16_t value)
-{ Wire.beginTransmission(I2CAddress); // write LSB first, refer to AN635 pg 35 figure 
-  Wire.write(reg);
-  Wire.write( value       & 0xFF); // value low byte
-  Wire.write((value >> 8) & 0xFF); // value high byte
-  byte last_status = Wire.endTransmission();
+bool MAX17263::writeReg16Bit(byte reg, uint16_t value) // retry on NAK, was ignoring the endTransmission() status
+{ for(byte attempt=0; attempt<=busRetries; attempt++) 
+  { Wire.beginTransmission(I2CAddress); // write LSB first, refer to AN635 pg 35 figure 
+    Wire.write(reg);
+    Wire.write( value       & 0xFF); // value low byte
+    Wire.write((value >> 8) & 0xFF); // value high byte
+    if(Wire.endTransmission() == 0) return 1;
+    busStats.retries++; 
+  }
+  busStats.writeErrors++;
+  Serial << "\nI2C write error reg " << _HEX(reg); 
+  return 0;
+}
+
+uint16_t MAX17263::readReg16Bit(byte reg) // 0xFFFF on error, like a missing battery, so no re-initialisation 
+{ uint16_t value;
+  return readRegs(reg, &value, 1) ? value : 0xFFFF; // not for a read-modify-write, use readRegs()
 }
 
-uint16_t MAX17263::readReg16Bit(byte reg)
-{ uint16_t value = 0;  
-  Wire.beginTransmission(I2CAddress); 
-  Wire.write(reg);
-  byte last_status = Wire.endTransmission(false);
-  
-  Wire.requestFrom(I2CAddress, (byte)2); 
-  value  = Wire.read();
-  value |= (uint16_t)Wire.read() << 8; // value low byte
-  return value;
+bool MAX17263::readRegs(byte reg, uint16_t *values, byte count) // values unchanged on error, count <= 16 (Wire buffer)
+{ for(byte attempt=0; attempt<=busRetries; attempt++) 
+  { Wire.beginTransmission(I2CAddress); 
+    Wire.write(reg);
+    if(Wire.endTransmission(false) == 0 && Wire.requestFrom(I2CAddress, (byte)(2*count)) == 2*count && Wire.available() >= 2*count) // was reading without Wire.available() 
+    { for(byte i=0; i<count; i++)
+      { values[i] = Wire.read();
+        values[i] |= (uint16_t)Wire.read() << 8; // value high byte
+      }
+      return 1;
+    }
+    busStats.retries++; 
+  }
+  busStats.readErrors++;
+  Serial << "\nI2C read error reg " << _HEX(reg); 
+  return 0;
 }
 
 bool MAX17263::waitForDNRdataNotReady()
-{ Serial << "\nWait for Data Not Ready: " << (bool)(readReg16Bit(regFStat) & 0x1) << " " << millis();
-  while(readReg16Bit(regFStat) & 0x1) delay(10); // FSTAT.DNR bit 
-  Serial << "\nData Not Ready: " << (bool)(readReg16Bit(regFStat) & 0x1) << " " << millis(); 
+{ uint16_t fstat = MAX17263FStatDNR::mask;
+  Serial << "\nWait for Data Not Ready " << millis();
+  uint32_t start = millis();
+  while(readRegs(regFStat, &fstat, 1) && (fstat & MAX17263FStatDNR::mask) && millis()-start < readyTimeout_ms) delay(10); // a bus error ends the wait
+  bool ready = !(fstat & MAX17263FStatDNR::mask); // the last read, values are unchanged on a bus error
+  Serial << "\nData Not Ready: " << !ready << " " << millis(); 
+  return ready; // was missing, undefined behaviour
 }
 
 void MAX17263::calcMultipliers(float rSense) 
@@ -117,51 +152,77 @@ void MAX17263::calcMultipliers(float rSense)
   Serial << "\ncurrent_multiplier_mV " << _FLOAT(current_multiplier_mV, 4);
 }
 
-void MAX17263::setDesignCap_mAh(long c) // max 65,535*2,5 = 163000mAh, uint16_t was wrong
-{ writeReg16Bit(regDesignCap, c/capacity_multiplier_mAH); // was batteryCapacity*2
-  Serial << "\nSet designCap " << readReg16Bit(regDesignCap) * capacity_multiplier_mAH;
+bool MAX17263::setDesignCap_mAh(long c) // max 65,535*2,5 = 163000mAh, uint16_t was wrong
+{ Serial << "\nSet designCap " << c;
+  return writeReg16Bit(regDesignCap, c/capacity_multiplier_mAH); // was batteryCapacity*2
 }  
 
-void MAX17263::setIchgTerm(uint16_t i)
-{ writeReg16Bit(regIchgTerm, i); // todo not tested
-  Serial << "\nSet IchgTerm " << _HEX(readReg16Bit(regIchgTerm));
+bool MAX17263::setIchgTerm(uint16_t i)
+{ Serial << "\nSet IchgTerm " << _HEX(i);
+  return writeReg16Bit(regIchgTerm, i); // todo not tested
 }
 
-void MAX17263::setVEmpty(float vf) 
-{ Serial << "\nVEmpty old " << _BIN(readReg16Bit(regVEmpty)); // default 0xA561 (3.3V/3.88V)
-  uint16_t ve = vf*100;
-  uint16_t val = readReg16Bit(regVEmpty);
-  val &= 0x7F; // 0000.0000.0111.1111 leave VR page 16/37
-  val |= ve << 7; // 3.3V = 330 = 101001010
-  writeReg16Bit(regVEmpty, val); 
-  Serial << "\nVEmpty new " << _BIN(readReg16Bit(regVEmpty));
+bool MAX17263::setVEmpty(float vf) 
+{ uint16_t ve = vf*100;
+  uint16_t val;
+  if(!readRegs(regVEmpty, &val, 1)) return 0; // writing back 0xFFFF would set VR as well
+  Serial << "\nVEmpty old " << _BIN(val); // default 0xA561 (3.3V/3.88V)
+  val &= ~MAX17263VEmptyVE::mask; // leave VR page 16/37
+  val |= MAX17263VEmptyVE::bits(ve); // 3.3V = 330 = 101001010
+  Serial << "\nVEmpty new " << _BIN(val);
+  return writeReg16Bit(regVEmpty, val); 
 }
 
-void MAX17263::refreshModelCFG(bool r100, bool vChg, byte modelID)
+bool MAX17263::refreshModelCFG(bool r100, bool vChg, byte modelID)
 { uint16_t cfgVal = 0;
-  cfgVal |=  modelID << 4;
-  cfgVal |=  vChg << 10; 
-  cfgVal |=  r100 << 13;
-  cfgVal |=  0x8000; // set refresh bit to 1 for model refresh
-  writeReg16Bit(regModelCfg, cfgVal); 
-  Serial << "\nRefresh modelCFG " << _BIN(readReg16Bit(regModelCfg));
+  cfgVal |=  MAX17263ModelCfgModelID::bits(modelID);
+  cfgVal |=  MAX17263ModelCfgVChg::bits(vChg); 
+  cfgVal |=  MAX17263ModelCfgR100::bits(r100);
+  cfgVal |=  MAX17263ModelCfgRefresh::bits(1); // set refresh bit to 1 for model refresh
+  Serial << "\nRefresh modelCFG " << _BIN(cfgVal);
+  return writeReg16Bit(regModelCfg, cfgVal); 
 }
 
 bool MAX17263::waitforModelCFGrefreshReady() 
-{ Serial << "\nWait for ModelCFG ready: " << (bool)(readReg16Bit(regModelCfg) & 0x8000) << " " << millis(); 
-  while(readReg16Bit(regModelCfg) & 0x8000) delay(10); // after ModelCFG reload the MAX1726x clears Refresh bit to 0 
-  Serial << "\nModelCFG ready: " << (bool)(readReg16Bit(regModelCfg) & 0x8000) << " " << millis(); 
+{ uint16_t modelCfg = MAX17263ModelCfgRefresh::mask;
+  Serial << "\nWait for ModelCFG ready " << millis(); 
+  uint32_t start = millis();
+  while(readRegs(regModelCfg, &modelCfg, 1) && (modelCfg & MAX17263ModelCfgRefresh::mask) && millis()-start < readyTimeout_ms) delay(10); // after ModelCFG reload the MAX1726x clears Refresh bit to 0, a bus error ends the wait
+  bool ready = !(modelCfg & MAX17263ModelCfgRefresh::mask);
+  Serial << "\nModelCFG ready: " << !ready << " " << millis(); 
+  return ready; // was missing, undefined behaviour
+}
+
+bool MAX17263::verifyConfigImage() // read every written configuration register once at the end, the written bits under their mask
+{ const struct { byte reg; uint16_t value, mask; } image[] = {
+    {regDesignCap, (uint16_t)(designCap_mAh/capacity_multiplier_mAH), 0xFFFF},
+    {regModelCfg, (uint16_t)(MAX17263ModelCfgR100::bits(r100) | MAX17263ModelCfgVChg::bits(vChg) | MAX17263ModelCfgModelID::bits(modelID)),
+     MAX17263ModelCfgRefresh::mask | MAX17263ModelCfgR100::mask | MAX17263ModelCfgVChg::mask | MAX17263ModelCfgModelID::mask}, // Refresh cleared by the chip
+    {regLedCfg1, ledCfg1Bits, ledCfg1Mask},
+    {regLedCfg2, ledCfg2Bits, ledCfg2Mask},
+  }; // IChgTerm and VEmpty keep their defaults, see setEZconfig()
+  configVerified = 1;
+  Serial << "\nVerify";
+  for(byte i=0; i<sizeof(image)/sizeof(image[0]); i++)
+  { uint16_t value = 0xFFFF;
+    bool same = readRegs(image[i].reg, &value, 1) && (value & image[i].mask) == image[i].value; // a bus error fails as well
+    configVerified &= same;
+    Serial << " " << _HEX(image[i].reg) << ":" << _HEX(value) << (same ? "" : "!");
+  }
+  Serial << (configVerified ? " OK" : " ERROR");
+  return configVerified;
 }
 
 void MAX17263::exitHibernate() // UG6595 page 7
-{ writeReg16Bit(0x60, 0x90); // Exit Hibernate Mode step 1
+{ writeReg16Bit(regCommand, 0x90); // Exit Hibernate Mode step 1
   writeReg16Bit(regHibCfg, 0x0); // Exit Hibernate Mode step 2
-  writeReg16Bit(0x60, 0x0); // Exit Hibernate Mode step 3
+  writeReg16Bit(regCommand, 0x0); // Exit Hibernate Mode step 3
 }
 
-void MAX17263::storeHibernateCFG()
-{ originalHibernateCFG = readReg16Bit(regHibCfg); // store original HibCFG value
-  Serial << "\nStore HibCfg: " << _HEX(originalHibernateCFG); 
+bool MAX17263::storeHibernateCFG() // false on a bus error, then nothing may be restored
+{ bool ok = readRegs(regHibCfg, &originalHibernateCFG, 1); // store original HibCFG value
+  Serial << "\nStore HibCfg: " << _HEX(originalHibernateCFG) << (ok ? "" : " ERROR"); 
+  return ok;
 } 
 
 void MAX17263::restoreHibernateCFG()
@@ -169,56 +230,64 @@ void MAX17263::restoreHibernateCFG()
   Serial << "\nRestore HibCfg: " << _HEX(originalHibernateCFG); 
 } 
 
-void MAX17263::clearPORpowerOnReset()
-{ uint16_t val = readReg16Bit(regStatus); // read status 
-  writeReg16Bit(regStatus, val & 0xFFFD); // clear POR bit 1111111111111101   
-  Serial << "\nClear POR power on reset: " << _HEX(val & 0xFFFD);  
+bool MAX17263::clearPORpowerOnReset() // false on a bus error, POR stays set
+{ uint16_t val;
+  if(!readRegs(regStatus, &val, 1)) return 0; // writing back 0xFFFF would set the other flags
+  val &= ~MAX17263StatusPOR::mask; // clear POR bit, keep the others
+  Serial << "\nClear POR power on reset: " << _HEX(val);  
+  return writeReg16Bit(regStatus, val);
 }
 
-void MAX17263::setLEDCfg1() 
-{ uint16_t val = readReg16Bit(regLedCfg1); // default 0x6070 page 29/37
+bool MAX17263::setLEDCfg1() 
+{ uint16_t val;
+  if(!readRegs(regLedCfg1, &val, 1)) return 0; // default 0x6070 page 29/37
   Serial << "\nLEDCfg1 old: " << _HEX(val);  
-  const byte LEDTimer = 2; // 0.6s because of T1 overheath
-  const bool LChg = 0; // default=1, no LEDs on while charging because of T1 overheath
-  const byte NBARS = 10; // using larger LED resistors may not achieve correct auto-count upon start up
-  val &= 0x1FD0; // 0001.1111.1101.0000, set variables to 0
-  val = val | LEDTimer<<13 | LChg<<5 | NBARS;
-  writeReg16Bit(regLedCfg1, val);  
+  val = (val & ~ledCfg1Mask) | ledCfg1Bits; // set variables
   Serial << "\nLEDCfg1 new: " << _HEX(val);  
+  return writeReg16Bit(regLedCfg1, val);  
 }
 
-void MAX17263::setLEDCfg2() 
-{ uint16_t val = readReg16Bit(regLedCfg2); // default 0x011f page 30/37
+bool MAX17263::setLEDCfg2() 
+{ uint16_t val;
+  if(!readRegs(regLedCfg2, &val, 1)) return 0; // default 0x011f page 30/37
   Serial << "\nLEDCfg2 old: " << _HEX(val);  
-  const bool EnAutoLEDCnt = 0; // 1->0 using larger LED resistors may not achieve correct auto-count upon start up
-  const bool EBlink = 1; // 0->1 blink lowest LED when empty is detected
-  const byte Brightness = 31; // max 31
-  val &= 0xFEA0; // 1111.1110.1010.0000, set variables to 0
-  val = val | EnAutoLEDCnt<<8 | EBlink<<6 | Brightness;
-  writeReg16Bit(regLedCfg2, val);  
+  val = (val & ~ledCfg2Mask) | ledCfg2Bits; // set variables
   Serial << "\nLEDCfg2 new: " << _HEX(val);  
+  return writeReg16Bit(regLedCfg2, val);  
 }
 
-void MAX17263::productionTest() // use UG6365 MAX17055 Software Implementation Guide (G6595 MAX1726x page 12 is WRONG)
+bool MAX17263::productionTest() // use UG6365 MAX17055 Software Implementation Guide (G6595 MAX1726x page 12 is WRONG)
 { Serial << "\nProduction Test "; 
-  uint16_t val1, val2; //kan anders
-// Step T2. Verify there are no memory leaks during Quickstart writing 
+  uint32_t t0 = millis(), t1, t2;
+  byte attempts = 0;
+  bool verified = 0;
   do
-  { val1 = readReg16Bit(regMiscCfg); // Step T1. Set the Quickstart and Verify bits
-    writeReg16Bit(regMiscCfg, val1 | 0x1400); // Set bits 10 and 12
-  
-    val2 = readReg16Bit(regMiscCfg); // Step T2. Verify there are no memory leaks during Quickstart writing 
-    val2 &= 0x1000; 
-  } while(!val2==0x1000); // Quickstart Success
-
- //Step T2: Wait for Quick Start to Complete
-//Poll MiscCFG.QS(0x0400) and FSTAT.DNR until they becomes 0 to confirm Quickstart is finished
- // while(readReg16Bit(regMiscCfg) & 0x0400 and ReadRegister(regFStat) & 1) delay(10)； 
-
- //do not continue quickstart is complete
-//Step T3: Read and Verify Outputs
-//The RepCap and RepSOC register locations should now contain accurate fuel-gauge results based on a battery voltage of 3.900V. The RepSOC (as a percent) is read from memory location 0x06h and the RepCap (in mAHrs) is read from memory location 0x05h.
-//RepCap = ReadRegister(0x05) ; //Read RepCap
-//RepSOC = ReadRegister(0x06) ; //Read RepSOC
-
+  { uint16_t val; // Step T1. Set the Quickstart and Verify bits, a bus error fails the step
+    if(!readRegs(regMiscCfg, &val, 1) || !writeReg16Bit(regMiscCfg, val | MAX17263MiscCfgQS::mask | MAX17263MiscCfgVerify::mask) ||
+       !readRegs(regMiscCfg, &val, 1)) break;
+    verified = val & MAX17263MiscCfgVerify::mask; // Verify there are no memory leaks during Quickstart writing 
+  } while(!verified && ++attempts < 3); // was while(!val2==0x1000) which never retried 
+  t1 = millis();
+  Serial << "\nT1 Quickstart verify: " << verified << " " << t1-t0 << "ms";
+  if(!verified) return 0;
+
+  // Step T2: Wait for Quick Start to Complete, poll MiscCFG.QS(0x0400) and FSTAT.DNR until they become 0 
+  bool ready;
+  uint16_t miscCfg, fstat; // a bus error is not ready
+  while(!(ready = readRegs(regMiscCfg, &miscCfg, 1) && !(miscCfg & MAX17263MiscCfgQS::mask) && readRegs(regFStat, &fstat, 1) &&
+                  !(fstat & MAX17263FStatDNR::mask)) && millis()-t1 < productionTestTimeout_ms) delay(10); 
+  t2 = millis();
+  Serial << "\nT2 Quickstart ready: " << ready << " " << t2-t1 << "ms";
+  if(!ready) return 0;
+
+  // Step T3: Read and Verify Outputs, RepCap and RepSOC now contain results based on a battery voltage of 3.900V
+  calcMultipliers(rSense);
+  uint16_t repCapRaw = 0, repSOCRaw = 0;
+  bool read = readRegs(regRepCap, &repCapRaw, 1) && readRegs(regRepSOC, &repSOCRaw, 1); // 0xFFFF of a bus error could pass the limits
+  float repCap = repCapRaw * capacity_multiplier_mAH; 
+  float repSOC = repSOCRaw * SOC_multiplier; 
+  bool pass = read && repSOC >= productionTestMinSOC && repSOC <= productionTestMaxSOC;
+  Serial << "\nT3 RepCap: " << _FLOAT(repCap, 1) << " mAH RepSOC: " << _FLOAT(repSOC, 1) << " % " << millis()-t2 << "ms";
+  Serial << "\nProduction Test " << (pass ? "PASS " : "FAIL ") << millis()-t0 << "ms";
+  return pass; 
 }
@@ -23,100 +23,246 @@ SOFTWARE.
 */
 
 #include "MAX17263.h"
-#include <Wire.h>
+#include <stddef.h>
+
+// Select the bus the gauge is connected to
+void MAX17263::begin(MAX17263Bus &bus) {
+    this->bus = &bus;
+}
+
+// Select the bus and the time source, e.g. a virtual clock of a test
+void MAX17263::begin(MAX17263Bus &bus, MAX17263Clock &clock) {
+    this->bus = &bus;
+    this->clock = &clock;
+}
 
 // Check if battery is present by examining the status register
 bool MAX17263::batteryPresent() {
     uint16_t status = getStatus();
     // Check BSt bit (bit 3) - 0 means battery present
-    return !(status & 0x0008);
+    return !(status & MAX17263StatusBSt::mask);
 }
 
 // Check if a power-on reset event has occurred
 bool MAX17263::powerOnResetEvent() {
     uint16_t status = getStatus();
     // Check POR bit (bit 1)
-    return (status & 0x0002);
+    return (status & MAX17263StatusPOR::mask);
 }
 
-// Initialize the MAX17263 fuel gauge
-void MAX17263::initialize() {
-    // Exit hibernate mode first
-    exitHibernate();
+// Check if a battery was inserted since the last initialize() or reinitializeAfterSwap().
+// Without POR the gauge stayed powered and kept its configuration, reinitializeAfterSwap() is enough.
+bool MAX17263::batterySwapEvent() {
+    uint16_t status = getStatus();
+    return (status & MAX17263StatusBI::mask) && !(status & MAX17263StatusBSt::mask);
+}
+
+// Initialize the MAX17263 fuel gauge, false on a fault
+bool MAX17263::initialize() {
+    uint32_t start = clock->millis();
+    clearReadCache();
+    fault = faultNone;
+
+    // Store original hibernate configuration, before exitHibernate() clears it.
+    // Without it the gauge is not touched, a garbage HibCfg would be restored at the end.
+    if (!storeHibernateCFG()) {
+        fault = faultBus;
+        initialize_ms = clock->millis() - start;
+        return false;
+    }
     
-    // Store original hibernate configuration
-    storeHibernateCFG();
+    // Exit hibernate mode
+    exitHibernate();
     
     // Wait for data to be ready
     if (!waitForDNRdataNotReady()) {
-        return; // Timeout or error
+        restoreHibernateCFG(); // leave the gauge as it was, POR stays set for the next attempt
+        initialize_ms = clock->millis() - start;
+        return false; // Timeout or bus error
     }
     
-    // Clear power-on reset flag
-    clearPORpowerOnReset();
-    
     // Calculate multipliers based on sense resistor
     calcMultipliers(rSense);
     
-    // Configure EZ model
+    // Configure EZ model and LEDs, only the registers that differ from the image are written.
+    // After a warm reset the configuration may still be in place, then the slow ModelCfg refresh is skipped.
+    buildConfigImage();
+    if (customModel && !loadCustomModel(customModel)) {
+        fault = faultModel; // a refresh would load a half-written table
+        restoreHibernateCFG();
+        initialize_ms = clock->millis() - start;
+        return false;
+    }
     setEZconfig();
     
-    // Configure LED settings if needed
-    setLEDCfg1();
-    setLEDCfg2();
+    // Clear power-on reset flag, only when the configuration is in place (UG6595 Step 3).
+    // After a fault POR stays set, so the next status check runs initialize() again.
+    if (fault == faultNone) {
+        clearPORpowerOnReset();
+    }
     
     // Restore hibernate configuration
     restoreHibernateCFG();
+    initialize_ms = clock->millis() - start;
+    return fault == faultNone;
 }
 
-// Production test function
-void MAX17263::productionTest() {
-    // Read and verify key registers
-    uint16_t status = getStatus();
-    uint16_t modelCfg = readReg16Bit(regModelCfg);
-    uint16_t designCapReg = readReg16Bit(regDesignCap);
-    
-    // Verify values are within expected ranges
-    if (status == 0xFFFF) {
-        // Communication error
+// Re-initialize after a battery swap without POR. The configuration survived, it is checked with
+// one read pass and only rewritten where it differs (e.g. a brown-out while the battery was out).
+// What the swap invalidates is the state of the old battery: Quickstart estimates SOC again
+// from the open circuit voltage of the new one, without the ModelCfg refresh and DNR waits.
+// Bounded by readyTimeout_ms per wait. Learned parameters of the new battery, if saved, can be
+// restored afterwards (UG6595 Step 3.6).
+bool MAX17263::reinitializeAfterSwap() {
+    uint32_t start = clock->millis();
+    if (powerOnResetEvent()) {
+        return initialize(); // the gauge lost power as well
+    }
+    clearReadCache();
+    fault = faultNone;
+    calcMultipliers(rSense);
+    buildConfigImage();
+    if (!verifyConfigImage()) {
+        setEZconfig();
+    }
+    if (fault == faultNone && quickstart()) {
+        clearPORpowerOnReset(); // also clears BI and BR
+    }
+    reinitialize_ms = clock->millis() - start;
+    return fault == faultNone;
+}
+
+// Acknowledge a battery removal seen by the last status read, the other Status bits are kept
+void MAX17263::clearBatteryRemoval() {
+    uint16_t status;
+    if (!(lastStatus & MAX17263StatusBR::mask) || !readRegs(regStatus, &status, 1)) {
         return;
     }
-    
-    // Additional production tests can be added here
-    // For example: verify voltage, current readings are reasonable
-    float voltage = getVcell();
-    if (voltage < 2.5 || voltage > 4.5) {
-        // Voltage out of expected range for Li-ion
+    writeReg16Bit(regStatus, status & ~MAX17263StatusBR::mask);
+    lastStatus = status & ~MAX17263StatusBR::mask;
+}
+
+// Production test, blocking version of the state machine below
+bool MAX17263::productionTest() {
+    startProductionTest();
+    while (productionTestBusy()) {
+        clock->delay(1);
+    }
+    return productionTestResult.pass;
+}
+
+// Start the production test, UG6365 MAX17055 Software Implementation Guide page 12
+// (UG6595 MAX1726x page 12 is wrong)
+void MAX17263::startProductionTest() {
+    memset(&productionTestResult, 0, sizeof(productionTestResult));
+    calcMultipliers(rSense); // RepCap conversion also works without initialize()
+    testStart_ms = testStepStart_ms = testPoll_ms = clock->millis();
+    testStep = testQuickstart;
+}
+
+// Run one step of the production test, returns false when the test is finished
+bool MAX17263::productionTestBusy() {
+    const byte maxQuickstartAttempts = 3;
+    const uint16_t pollInterval_ms = 10;
+
+    switch (testStep) {
+    case testQuickstart: {
+        // Step T1: set the Quickstart (bit 10) and Verify (bit 12) bits
+        // A bus error fails the step, 0xFFFF written back or read back would pass on garbage
+        uint16_t miscCfg;
+        if (!readRegs(regMiscCfg, &miscCfg, 1) ||
+            !writeReg16Bit(regMiscCfg, miscCfg | MAX17263MiscCfgQS::mask | MAX17263MiscCfgVerify::mask) ||
+            !readRegs(regMiscCfg, &miscCfg, 1)) {
+            failProductionTest();
+            break;
+        }
+        productionTestResult.quickstartAttempts++;
+        // Verify there are no memory leaks during Quickstart writing
+        if (miscCfg & MAX17263MiscCfgVerify::mask) {
+            endProductionTestStep(testWaitQuickstart);
+        } else if (productionTestResult.quickstartAttempts >= maxQuickstartAttempts) {
+            failProductionTest();
+        }
+        break;
     }
+    case testWaitQuickstart:
+        // Step T2: poll MiscCfg.QS and FStat.DNR until both are 0, without blocking
+        if ((uint32_t)(clock->millis() - testPoll_ms) < pollInterval_ms) {
+            break;
+        }
+        testPoll_ms = clock->millis();
+        if (!readField<MAX17263MiscCfgQS>() && !readField<MAX17263FStatDNR>()) {
+            endProductionTestStep(testVerifyOutputs);
+        } else if ((uint32_t)(clock->millis() - testStepStart_ms) > productionTestTimeout_ms) {
+            failProductionTest();
+        }
+        break;
+    case testVerifyOutputs:
+        // Step T3: RepCap and RepSOC now contain results based on the fixture battery voltage
+        if (!readRegs(regRepCap, &productionTestResult.repCapRaw, 1) ||
+            !readRegs(regRepSOC, &productionTestResult.repSOCRaw, 1)) {
+            failProductionTest();
+            break;
+        }
+        productionTestResult.repCap_mAh = productionTestResult.repCapRaw * capacity_multiplier_mAH;
+        productionTestResult.repSOC = productionTestResult.repSOCRaw * SOC_multiplier;
+        if (productionTestResult.repSOC < productionTestMinSOC ||
+            productionTestResult.repSOC > productionTestMaxSOC) {
+            failProductionTest();
+        } else {
+            endProductionTestStep(testDone);
+            productionTestResult.pass = true;
+        }
+        break;
+    default:
+        return false;
+    }
+    return testStep != testDone;
+}
+
+// Store the duration of the current step and go to the next step
+void MAX17263::endProductionTestStep(MAX17263ProductionTestStep next) {
+    uint32_t now = clock->millis();
+    productionTestResult.stepDuration_ms[testStep - testQuickstart] = now - testStepStart_ms;
+    productionTestResult.total_ms = now - testStart_ms;
+    testStepStart_ms = now;
+    testStep = next;
+}
+
+// Stop the production test at the current step
+void MAX17263::failProductionTest() {
+    productionTestResult.failedStep = testStep;
+    productionTestResult.pass = false;
+    endProductionTestStep(testDone);
 }
 
 // Get current in mA
 float MAX17263::getCurrent() {
-    int16_t currentRaw = (int16_t)readReg16Bit(regCurrent);
+    int16_t currentRaw = (int16_t)readCached(regCurrent);
     return (float)currentRaw * current_multiplier_mV;
 }
 
 // Get cell voltage in V
 float MAX17263::getVcell() {
-    uint16_t vcellRaw = readReg16Bit(regVCell);
+    uint16_t vcellRaw = readCached(regVCell);
     return (float)vcellRaw * voltage_multiplier_V;
 }
 
 // Get capacity in mAh
 float MAX17263::getCapacity_mAh() {
-    uint16_t repCap = readReg16Bit(regRepCap);
+    uint16_t repCap = readCached(regRepCap);
     return (float)repCap * capacity_multiplier_mAH;
 }
 
 // Get state of charge in %
 float MAX17263::getSOC() {
-    uint16_t soc = readReg16Bit(regRepSOC);
+    uint16_t soc = readCached(regRepSOC);
     return (float)soc * SOC_multiplier;
 }
 
 // Get time to empty in hours
 float MAX17263::getTimeToEmpty() {
-    uint16_t tte = readReg16Bit(regTimeToEmpty);
+    uint16_t tte = readCached(regTimeToEmpty);
     if (tte == 0xFFFF) {
         return -1; // Indicates charging or no valid estimate
     }
@@ -125,151 +271,631 @@ float MAX17263::getTimeToEmpty() {
 
 // Get temperature in Celsius
 float MAX17263::getTemp() {
-    int16_t tempRaw = (int16_t)readReg16Bit(regTemp);
+    int16_t tempRaw = (int16_t)readCached(regTemp);
     // Temperature is in 1/256 degrees Celsius
     return (float)tempRaw / 256.0;
 }
 
 // Get average cell voltage
 float MAX17263::getAvgVCell() {
-    uint16_t avgVcellRaw = readReg16Bit(regAvgVCell);
+    uint16_t avgVcellRaw = readCached(regAvgVCell);
     return (float)avgVcellRaw * voltage_multiplier_V;
 }
 
+// Get the power of the last conversion in mW, computed by the gauge from one VCell/Current pair
+float MAX17263::getPower_mW() {
+    int16_t powerRaw = (int16_t)readCached(regPower); // sets dataStale on a bus error
+    return (float)powerRaw * power_multiplier_mW;
+}
+
+// Get the average power in mW
+float MAX17263::getAvgPower_mW() {
+    int16_t powerRaw = (int16_t)readCached(regAvgPower);
+    return (float)powerRaw * power_multiplier_mW;
+}
+
+// Integrate AvgPower over the time since the previous sample, in raw x ms. The gauge averages
+// the VCell x Current products itself, so the samples may be sparse. After a bus error the next
+// sample covers the gap, up to energyMaxGap_ms.
+bool MAX17263::accumulateEnergy() {
+    uint32_t now = clock->millis();
+    if (energyStarted && (uint32_t)(now - energyTime_ms) < energyInterval_ms) {
+        return true;
+    }
+    uint16_t powerRaw;
+    if (!readRegs(regAvgPower, &powerRaw, 1)) {
+        return false;
+    }
+    if (energyStarted) {
+        uint32_t gap_ms = now - energyTime_ms;
+        if (gap_ms > energyMaxGap_ms) { // one AvgPower sample does not represent it, e.g. the bus was down
+            gap_ms = energyMaxGap_ms;
+            energyGaps++;
+        }
+        energy_raw_ms += (int64_t)(int16_t)powerRaw * gap_ms; // int32 overflows after 65s at full scale
+    }
+    energyTime_ms = now;
+    energyStarted = true;
+    return true;
+}
+
+// Energy in mWh: LSB 8uV^2/rSense = 8000/rSense_uOhm mW, 1 mWh = 3600000 mW x ms
+int32_t MAX17263::getEnergy_mWh() {
+    int32_t rSense_uOhm = rSense * 1e6 + 0.5;
+    return energy_raw_ms / ((int64_t)rSense_uOhm * 450);
+}
+
+// Restart the energy accumulation
+void MAX17263::resetEnergy() {
+    energy_raw_ms = 0;
+    energyStarted = false;
+}
+
+// Register a change callback, returns false if all MAX17263_MAX_SUBSCRIPTIONS are in use
+bool MAX17263::subscribe(MAX17263Quantity quantity, float delta, float hysteresis, MAX17263ChangeCallback callback, void *context) {
+    calcMultipliers(rSense);
+    for (byte i = 0; i < MAX17263_MAX_SUBSCRIPTIONS; i++) {
+        MAX17263Subscription &sub = subscriptions[i];
+        if (sub.callback) {
+            continue;
+        }
+        // Thresholds in raw LSBs, so the periodic check is integer only
+        float lsb = quantityLSB(quantity);
+        sub.delta = max(1.0f, min(65535.0f, delta / lsb + 0.5f));
+        sub.hysteresis = min(65535.0f, hysteresis / lsb + 0.5f);
+        sub.quantity = quantity;
+        sub.context = context;
+        sub.lastDirection = 0;
+        sub.published = readCached(quantityReg(quantity));
+        sub.callback = callback;
+        return true;
+    }
+    return false;
+}
+
+// Remove all subscriptions of callback
+void MAX17263::unsubscribe(MAX17263ChangeCallback callback) {
+    for (byte i = 0; i < MAX17263_MAX_SUBSCRIPTIONS; i++) {
+        if (subscriptions[i].callback == callback) {
+            subscriptions[i].callback = 0;
+        }
+    }
+}
+
+// Check the subscribed quantities and call back on significant changes
+void MAX17263::publishChanges() {
+    for (byte i = 0; i < MAX17263_MAX_SUBSCRIPTIONS; i++) {
+        MAX17263Subscription &sub = subscriptions[i];
+        if (!sub.callback) {
+            continue;
+        }
+        uint16_t raw = readCached(quantityReg(sub.quantity));
+        if (dataStale || raw == sub.published) {
+            continue; // a bus error is no change; the common case, no arithmetic at all
+        }
+        int32_t diff = quantitySigned(sub.quantity) ? (int32_t)(int16_t)raw - (int16_t)sub.published
+                                                    : (int32_t)raw - sub.published;
+        int8_t direction = diff > 0 ? 1 : -1;
+        uint32_t threshold = sub.delta;
+        if (sub.lastDirection && direction != sub.lastDirection) {
+            threshold += sub.hysteresis; // reversal, suppresses toggling around a threshold
+        }
+        if ((uint32_t)abs(diff) < threshold) {
+            continue;
+        }
+        sub.published = raw;
+        sub.lastDirection = direction;
+        sub.callback(sub.quantity, convert(sub.quantity, raw), sub.context);
+    }
+}
+
+// Read any quantity, e.g. for MAX17263Sampler
+float MAX17263::getQuantity(MAX17263Quantity quantity) {
+    return convert(quantity, readCached(quantityReg(quantity)));
+}
+
+// Read the measurements of one moment: RepCap..Current in one burst, the chip time, then TTE and AvgVCell
+bool MAX17263::readSnapshot(MAX17263Snapshot &snapshot) {
+    uint16_t burst[6];
+    snapshot.time_ms = clock->millis();
+    if (!readRegs(regRepCap, burst, 6) || !readChipTime(snapshot.timer, snapshot.timerH)) {
+        return false;
+    }
+    snapshot.repCap = burst[0];
+    snapshot.repSOC = burst[1];
+    snapshot.age = burst[2];
+    snapshot.temp = burst[3];
+    snapshot.vCell = burst[4];
+    snapshot.current = burst[5];
+    return readRegs(regTimeToEmpty, &snapshot.timeToEmpty, 1) && readRegs(regAvgVCell, &snapshot.avgVCell, 1);
+}
+
+// Bursts of readMeasurements(), offset is the word index of the first register in MAX17263Measurements
+#define MAX17263_GROUP(group, first, last, member) \
+    {group, MAX17263Reg##first::address, MAX17263Reg##last::address - MAX17263Reg##first::address + 1, \
+     offsetof(MAX17263Measurements, member) / sizeof(uint16_t)}
+static const struct { byte group, reg, count, offset; } measurementBursts[] = {
+    MAX17263_GROUP(groupGauge, RepCap, AvgCurrent, repCap),
+    MAX17263_GROUP(groupHistory, FullCapRep, MaxMinCurr, fullCapRep),
+    MAX17263_GROUP(groupFull, TimeToFull, FullCapNom, timeToFull),
+    MAX17263_GROUP(groupQH, QH, QH, qh),
+    MAX17263_GROUP(groupTimer, Timer, Timer, timer),
+    MAX17263_GROUP(groupTimer, TimerH, TimerH, timerH),
+};
+static_assert(offsetof(MAX17263Measurements, timerH) == 26 * sizeof(uint16_t), "the register words must not be padded");
+
+// Read the register groups, one burst per group instead of a transaction per register.
+// m.valid tells which groups were read, the others keep their old words.
+bool MAX17263::readMeasurements(MAX17263Measurements &m, byte groups) {
+    uint16_t *words = &m.repCap;
+    byte failed = 0; // a group fails when one of its bursts fails, groupTimer has two
+    m.time_ms = clock->millis();
+    for (byte i = 0; i < sizeof(measurementBursts) / sizeof(measurementBursts[0]); i++) {
+        if ((groups & measurementBursts[i].group) &&
+            !readRegs(measurementBursts[i].reg, words + measurementBursts[i].offset, measurementBursts[i].count)) {
+            failed |= measurementBursts[i].group;
+        }
+    }
+    m.valid = groups & groupAll & ~failed;
+    return !failed;
+}
+
+// Chip time of a snapshot, one transaction: TimerH only changes when Timer rolls over (every 3.2 hours),
+// so it is counted here. It is read from the chip the first time, after clearReadCache(), when
+// the previous snapshot is more than an hour ago, then a roll over could have been missed, and when
+// Timer went back: a roll over or a POR, which restarts both registers, only TimerH tells them apart.
+bool MAX17263::readChipTime(uint16_t &timer, uint16_t &timerH) {
+    uint32_t now = clock->millis();
+    bool counted = chipTimerHKnown && (uint32_t)(now - lastTimer_ms) < 3600000UL;
+    if (counted) {
+        if (!readRegs(regTimer, &timer, 1)) {
+            return false;
+        }
+        counted = timer >= lastTimer;
+    }
+    if (!counted) {
+        uint16_t before, after;
+        if (!readRegs(regTimerH, &before, 1) || !readRegs(regTimer, &timer, 1) || !readRegs(regTimerH, &after, 1)) {
+            return false;
+        }
+        // When Timer rolled over between the reads, a small Timer belongs to the new TimerH
+        chipTimerH = before == after || timer < 0x8000 ? after : before;
+        chipTimerHKnown = true;
+    }
+    lastTimer = timer;
+    lastTimer_ms = now;
+    timerH = chipTimerH;
+    return true;
+}
+
+// Convert a raw word, e.g. from a snapshot, the same way the getters do
+float MAX17263::convert(MAX17263Quantity quantity, uint16_t raw) {
+    return quantitySigned(quantity) ? (int16_t)raw * quantityLSB(quantity) : raw * quantityLSB(quantity);
+}
+
+// MaxMin registers: a byte each, VCell 20mV unsigned, Current 0.4mV/rSense and Temp 1 degree signed
+float MAX17263::convertMaxMin(MAX17263Quantity quantity, uint16_t raw, bool max) {
+    byte b = max ? MAX17263MaxMinVoltMax::get(raw) : MAX17263MaxMinVoltMin::get(raw);
+    switch (quantity) {
+    case quantityCurrent: return (int8_t)b * MAX17263RegMaxMinCurr::lsb() / rSense;
+    case quantityTemp: return (int8_t)b * MAX17263RegMaxMinTemp::lsb();
+    default: return b * MAX17263RegMaxMinVolt::lsb();
+    }
+}
+
+// Step 3.5: the learned parameters must be saved every time bit 2 of Cycles toggles
+bool MAX17263::learnedParamsDue() {
+    uint16_t cycles;
+    return readRegs(regCycles, &cycles, 1) && ((cycles ^ savedCycles) & MAX17263CyclesSave::mask); // a bus error is no toggle
+}
+
+// Step 3.5: read the learned parameters, store them in non-volatile memory for restoring after POR
+bool MAX17263::saveLearnedParams(MAX17263LearnedParams &params) {
+    uint16_t rComp0TempCo[2]; // adjacent registers, one burst
+    MAX17263LearnedParams p;
+    bool ok = readRegs(regRComp0, rComp0TempCo, 2) &&
+              readRegs(regFullCapRep, &p.fullCapRep, 1) &&
+              readRegs(regCycles, &p.cycles, 1) &&
+              readRegs(regFullCapNom, &p.fullCapNom, 1);
+    if (!ok) {
+        return false; // params keeps the last saved values
+    }
+    p.rComp0 = rComp0TempCo[0];
+    p.tempCo = rComp0TempCo[1];
+    params = p;
+    savedCycles = p.cycles;
+    return true;
+}
+
+// Register ranges of dumpAll(), the gaps stay 0 in the dump:
+//   0x50..0x7F  Command (0x60) and the model lock (0x62, 0x63): write-only in use, the rest reserved
+//   0x80..0xAF  model table, reads as zeros while locked; unlocking for a dump would change the chip
+//               state; initialize() checks it against the custom model while unlocked
+//   0xC0..0xCF  reserved in the UG6597 register map, no register the driver or a debug session uses
+static const struct { byte reg, count; } dumpRanges[] = {
+    {0x00, 0x50}, // measurements, status and configuration
+    {0xB0, 0x10}, // Status2, Power, AvgPower, HibCfg, Config2, ...
+    {0xD0, 0x30}, // ModelCfg, VFOCV, VFSOC
+};
+
+// Read the whole register space, one burst per range, e.g. for field debugging.
+// regs is a 512 byte blob, index = register address, see extras/host/dump_tool.cpp.
+bool MAX17263::dumpAll(uint16_t *regs) {
+    memset(regs, 0, 256 * sizeof(uint16_t));
+    bool ok = true;
+    for (byte i = 0; i < sizeof(dumpRanges) / sizeof(dumpRanges[0]); i++) {
+        ok &= readRegs(dumpRanges[i].reg, regs + dumpRanges[i].reg, dumpRanges[i].count);
+    }
+    return ok;
+}
+
 // Private functions
 
+// Register of a subscribable quantity
+byte MAX17263::quantityReg(MAX17263Quantity quantity) {
+    switch (quantity) {
+    case quantitySOC: return regRepSOC;
+    case quantityCapacity: return regRepCap;
+    case quantityVCell: return regVCell;
+    case quantityCurrent: return regCurrent;
+    case quantityTemp: return regTemp;
+    case quantityTimeToEmpty: return regTimeToEmpty;
+    case quantityPower: return regPower;
+    case quantityAvgPower: return regAvgPower;
+    case quantityAvgCurrent: return regAvgCurrent;
+    case quantityTimeToFull: return regTimeToFull;
+    case quantityFullCapRep: return regFullCapRep;
+    case quantityFullCapNom: return regFullCapNom;
+    case quantityCycles: return regCycles;
+    case quantityAge: return regAge;
+    case quantityAvgTA: return regAvgTA;
+    case quantityQH: return regQH;
+    default: return regAvgVCell;
+    }
+}
+
+// Currents, temperatures, the powers and QH are two's complement
+bool MAX17263::quantitySigned(MAX17263Quantity quantity) {
+    switch (quantity) {
+    case quantityCurrent:
+    case quantityTemp:
+    case quantityPower:
+    case quantityAvgPower:
+    case quantityAvgCurrent:
+    case quantityAvgTA:
+    case quantityQH: return true;
+    default: return false;
+    }
+}
+
+// Unit of one LSB, the same factors the getters use
+float MAX17263::quantityLSB(MAX17263Quantity quantity) {
+    switch (quantity) {
+    case quantitySOC: return SOC_multiplier;
+    case quantityCapacity:
+    case quantityFullCapRep:
+    case quantityFullCapNom:
+    case quantityQH: return capacity_multiplier_mAH;
+    case quantityCurrent:
+    case quantityAvgCurrent: return current_multiplier_mV;
+    case quantityTemp:
+    case quantityAvgTA: return 1.0 / 256.0;
+    case quantityTimeToEmpty:
+    case quantityTimeToFull: return time_multiplier_Hours;
+    case quantityCycles: return MAX17263RegCycles::lsb();
+    case quantityAge: return MAX17263RegAge::lsb();
+    case quantityPower:
+    case quantityAvgPower: return power_multiplier_mW;
+    default: return voltage_multiplier_V;
+    }
+}
+
 // Get status register
+// On a bus error the last good status is used, without POR, so a noisy bus cannot trigger a re-initialization
 uint16_t MAX17263::getStatus() {
-    return readReg16Bit(regStatus);
+    uint16_t status;
+    if (readRegs(regStatus, &status, 1)) {
+        lastStatus = status;
+        return status;
+    }
+    // A gauge that holds SDA low answers no more, try to free the bus once
+    if (recoverBus() && readRegs(regStatus, &status, 1)) {
+        lastStatus = status;
+        return status;
+    }
+    busStats.fallbacks++;
+    return lastStatus & ~MAX17263StatusPOR::mask;
 }
 
-// Wait for DNR (Data Not Ready) bit to clear
-bool MAX17263::waitForDNRdataNotReady() {
-    uint32_t timeout = millis() + 1000; // 1 second timeout
-    
-    while (millis() < timeout) {
-        uint16_t fstat = readReg16Bit(regFStat);
-        // Check DNR bit (bit 0)
-        if (!(fstat & 0x0001)) {
-            return true; // Data is ready
+// Free the bus after an interrupted transfer left SDA low, e.g. an MCU reset in the middle of a read
+bool MAX17263::recoverBus() {
+    if (!bus->clearBus()) {
+        return false;
+    }
+    busStats.busClears++;
+    return true;
+}
+
+// Poll reg every 10ms until the mask bits are clear, within readyTimeout_ms, also across a millis() wrap around
+bool MAX17263::waitForClear(byte reg, uint16_t mask, MAX17263Fault timeoutFault) {
+    uint32_t start = clock->millis();
+    while ((uint32_t)(clock->millis() - start) < readyTimeout_ms) {
+        uint16_t value;
+        if (!readRegs(reg, &value, 1)) {
+            fault = faultBus; // polling a dead bus for the rest of the timeout only wastes transactions
+            return false;
         }
-        delay(10);
+        if (!(value & mask)) {
+            return true;
+        }
+        clock->delay(10);
     }
+    fault = timeoutFault;
     return false; // Timeout
 }
 
-// Clear power-on reset flag
-void MAX17263::clearPORpowerOnReset() {
-    uint16_t status = readReg16Bit(regStatus);
-    // Clear POR bit by writing 0 to bit 1, keep other bits
-    status &= ~0x0002;
-    writeReg16Bit(regStatus, status);
+// Wait for DNR (Data Not Ready) bit to clear
+bool MAX17263::waitForDNRdataNotReady() {
+    return waitForClear(regFStat, MAX17263FStatDNR::mask, faultDataNotReady);
+}
+
+// Clear power-on reset flag, false on a bus error, then POR stays set
+bool MAX17263::clearPORpowerOnReset() {
+    uint16_t status;
+    if (!readRegs(regStatus, &status, 1)) {
+        return false; // writing back a garbage status would clear or set other flags
+    }
+    // Clear POR bit by writing 0 to bit 1, keep other bits. A battery swap is handled as well, BI and BR.
+    status &= ~(MAX17263StatusPOR::mask | MAX17263StatusBI::mask | MAX17263StatusBR::mask);
+    return writeReg16Bit(regStatus, status);
 }
 
 // Calculate current and capacity multipliers based on sense resistor
 void MAX17263::calcMultipliers(float rSense) {
     // Current LSB = 1.5625μV / Rsense
-    current_multiplier_mV = 1.5625e-6 / rSense * 1000; // Convert to mA
+    current_multiplier_mV = MAX17263RegCurrent::lsb() / rSense; // mA
     
     // Capacity LSB = 5μVh / Rsense
-    capacity_multiplier_mAH = 5.0e-6 / rSense; // Convert to mAh
+    capacity_multiplier_mAH = MAX17263RegRepCap::lsb() / rSense; // mAh
+    
+    // Power LSB = 8μV² / Rsense
+    power_multiplier_mW = MAX17263RegPower::lsb() / rSense; // mW
 }
 
-// Set design capacity
-void MAX17263::setDesignCap_mAh(long c) {
-    uint16_t designCapReg = (uint16_t)(c / capacity_multiplier_mAH);
-    writeReg16Bit(regDesignCap, designCapReg);
+// The configuration image of the battery parameters, for drivers of the same sequence on another
+// bus API (extras/host/MAX17263Coro.h), at most MAX17263_CONFIG_SIZE entries
+byte MAX17263::configurationImage(MAX17263ConfigEntry *image) {
+    calcMultipliers(rSense);
+    buildConfigImage();
+    memcpy(image, configImage, configImageSize * sizeof(MAX17263ConfigEntry));
+    return configImageSize;
 }
 
-// Set charge termination current
-void MAX17263::setIchgTerm(uint16_t i) {
-    writeReg16Bit(regIchgTerm, i);
+// Compile the battery parameters into the configuration image, sorted by register address.
+// ModelCfg is last, so its Refresh bit is written after the registers the refresh uses.
+void MAX17263::buildConfigImage() {
+    MAX17263ConfigEntry *e = configImage;
+    *e++ = {regDesignCap, (uint16_t)(designCap_mAh / capacity_multiplier_mAH), 0xFFFF};
+    if (swapAlert) {
+        uint16_t alert = MAX17263ConfigBer::mask | MAX17263ConfigBei::mask | MAX17263ConfigAen::mask;
+        *e++ = {regConfig, alert, alert};
+    }
+    *e++ = {regIchgTerm, ichgTerm, 0xFFFF};
+    // VEmpty register format: bit 15-7 for VE (10mV resolution), bit 6-0 for VR (40mV resolution) is kept
+    *e++ = {regVEmpty, MAX17263VEmptyVE::bits(vEmpty * 100), MAX17263VEmptyVE::mask};
+    *e++ = {regLedCfg1, ledCfg1Value, 0xFFFF}; // Example value, enable LED, set timing and thresholds
+    *e++ = {regLedCfg2, ledCfg2Value, 0xFFFF}; // Example value
+    // ModelCfg: Refresh (bit 15), R100 (bit 13), VChg (bit 10), model ID (bits 4-7), other bits kept
+    uint16_t modelCfg = MAX17263ModelCfgRefresh::bits(1) | MAX17263ModelCfgR100::bits(r100) |
+                        MAX17263ModelCfgVChg::bits(vChg) | MAX17263ModelCfgModelID::bits(modelID);
+    *e++ = {regModelCfg, modelCfg, MAX17263ModelCfgRefresh::mask | MAX17263ModelCfgR100::mask |
+                                   MAX17263ModelCfgVChg::mask | MAX17263ModelCfgModelID::mask};
+    configImageSize = e - configImage;
 }
 
-// Set empty voltage
-void MAX17263::setVEmpty(float vf) {
-    // VEmpty register format: bit 15-7 for VE (10mV resolution), bit 6-0 for VR (40mV resolution)
-    uint16_t ve = (uint16_t)(vf * 100); // Convert to 10mV units
-    ve = (ve << 7) | 0x0A; // Default VR value
-    writeReg16Bit(regVEmpty, ve);
+// Read the chip values of the image registers. Gaps of up to 8 registers are read along,
+// so DesignCap..IChgTerm, VEmpty..LEDCfg2 and ModelCfg take three bursts.
+bool MAX17263::readImage(const MAX17263ConfigEntry *image, byte size, uint16_t *current) {
+    const byte maxGap = 8, maxSpan = 20;
+    uint16_t block[maxSpan];
+    for (byte i = 0, j; i < size; i = j + 1) {
+        for (j = i; j + 1 < size && image[j + 1].reg - image[j].reg <= maxGap &&
+                    image[j + 1].reg - image[i].reg < maxSpan; j++) {
+        }
+        if (!readRegs(image[i].reg, block, image[j].reg - image[i].reg + 1)) {
+            return false;
+        }
+        for (byte k = i; k <= j; k++) {
+            current[k] = block[image[k].reg - image[i].reg];
+        }
+    }
+    return true;
 }
 
-// Refresh model configuration
-void MAX17263::refreshModelCFG(bool r100, bool vChg, byte modelID) {
-    uint16_t modelCfg = readReg16Bit(regModelCfg);
-    
-    // Clear refresh bit and model bits
-    modelCfg &= ~0x8F00;
-    
-    // Set model ID (bits 4-7)
-    modelCfg |= ((modelID & 0x0F) << 4);
-    
-    // Set R100 bit (bit 13) if needed
-    if (r100) {
-        modelCfg |= 0x2000;
+// Write the entries selected by dirty (bit per entry), merged with the chip values in current.
+// Contiguous registers are written in one burst.
+bool MAX17263::writeImage(const MAX17263ConfigEntry *image, byte size, const uint16_t *current, uint32_t dirty) {
+    uint16_t block[MAX17263_CONFIG_SIZE];
+    bool ok = true;
+    for (byte i = 0, j; i < size; i = j + 1) {
+        j = i;
+        if (!(dirty & (1UL << i))) {
+            continue;
+        }
+        block[0] = (current[i] & ~image[i].mask) | (image[i].value & image[i].mask);
+        while (j + 1 < size && (dirty & (1UL << (j + 1))) && image[j + 1].reg == image[j].reg + 1) {
+            j++;
+            block[j - i] = (current[j] & ~image[j].mask) | (image[j].value & image[j].mask);
+        }
+        ok &= writeRegs(image[i].reg, block, j - i + 1);
     }
-    
-    // Set VChg bit (bit 10) if needed
-    if (vChg) {
-        modelCfg |= 0x0400;
+    return ok;
+}
+
+// One read pass over the configuration, true if every image bit is in place
+bool MAX17263::verifyConfigImage() {
+    uint16_t current[MAX17263_CONFIG_SIZE];
+    configVerified = readImage(configImage, configImageSize, current);
+    for (byte i = 0; configVerified && i < configImageSize; i++) {
+        uint16_t mask = configImage[i].mask & ~configSelfClearing(configImage[i].reg);
+        configVerified = (current[i] & mask) == (configImage[i].value & mask);
     }
-    
-    // Set refresh bit (bit 15)
-    modelCfg |= 0x8000;
-    
-    writeReg16Bit(regModelCfg, modelCfg);
+    return configVerified;
+}
+
+// Bits the chip clears by itself, ModelCfg.Refresh
+uint16_t MAX17263::configSelfClearing(byte reg) {
+    return reg == regModelCfg ? MAX17263ModelCfgRefresh::mask : 0;
 }
 
-// Wait for model configuration refresh to complete
+// Registers of the model, a change must be loaded with ModelCfg.Refresh; LEDs and alerts need none
+bool MAX17263::configNeedsRefresh(byte reg) {
+    return reg != regLedCfg1 && reg != regLedCfg2 && reg != regConfig;
+}
+
+// Wait for model configuration refresh to complete, the chip clears ModelCfg.Refresh (bit 15)
 bool MAX17263::waitforModelCFGrefreshReady() {
-    uint32_t timeout = millis() + 1000; // 1 second timeout
-    
-    while (millis() < timeout) {
-        uint16_t modelCfg = readReg16Bit(regModelCfg);
-        // Check if refresh bit (bit 15) is cleared
-        if (!(modelCfg & 0x8000)) {
-            return true; // Refresh complete
-        }
-        delay(10);
+    return waitForClear(regModelCfg, MAX17263ModelCfgRefresh::mask, faultRefresh);
+}
+
+// Quickstart: a new SOC estimate from the open circuit voltage, e.g. after a battery was inserted
+bool MAX17263::quickstart() {
+    uint16_t miscCfg;
+    if (!readRegs(regMiscCfg, &miscCfg, 1) || !writeReg16Bit(regMiscCfg, miscCfg | MAX17263MiscCfgQS::mask)) {
+        fault = faultBus;
+        return false;
     }
-    return false; // Timeout
+    return waitForClear(regMiscCfg, MAX17263MiscCfgQS::mask, faultQuickstart);
 }
 
-// Configure EZ model
+// Configure EZ model and LEDs from the configuration image in one pass, verified at the end
 void MAX17263::setEZconfig() {
-    // Wait for any ongoing operations
-    waitForDNRdataNotReady();
-    
-    // Set design capacity
-    setDesignCap_mAh(designCap_mAh);
-    
-    // Set charge termination current
-    setIchgTerm(ichgTerm);
-    
-    // Set empty voltage
-    setVEmpty(vEmpty);
-    
-    // Refresh model configuration
-    refreshModelCFG(r100, vChg, modelID);
-    
-    // Wait for refresh to complete
-    waitforModelCFGrefreshReady();
+    uint16_t current[MAX17263_CONFIG_SIZE];
+    if (!readImage(configImage, configImageSize, current)) {
+        configVerified = false;
+        fault = faultBus;
+        return;
+    }
+    uint32_t dirty = 0;
+    bool modelDiffers = false;
+    for (byte i = 0; i < configImageSize; i++) {
+        uint16_t mask = configImage[i].mask & ~configSelfClearing(configImage[i].reg);
+        if ((current[i] & mask) != (configImage[i].value & mask)) {
+            dirty |= 1UL << i;
+            modelDiffers |= configNeedsRefresh(configImage[i].reg);
+        }
+    }
+    modelDiffers |= forceModelRefresh;
+    forceModelRefresh = false;
+    modelRefreshSkipped = !modelDiffers;
+    if (modelDiffers) {
+        // Wait for any ongoing operations
+        waitForDNRdataNotReady();
+        dirty |= 1UL << (configImageSize - 1); // ModelCfg with the Refresh bit
+    }
+    writeImage(configImage, configImageSize, current, dirty);
+    if (modelDiffers) {
+        // Wait for refresh to complete
+        waitforModelCFGrefreshReady();
+    }
+    if (!verifyConfigImage() && fault == faultNone) {
+        fault = faultConfig;
+    }
+}
+
+// Upload a custom model, UG6595 Step 2.2 Option 3: unlock, write the model table in bursts,
+// read it back, lock, check the lock and write the characterisation registers.
+// The following setEZconfig() writes ModelCfg.Refresh, which loads the model.
+// The model is read from flash chunk by chunk, without a RAM copy. When the chip table
+// already has the checksum of the model (warm reset), the upload and the refresh are skipped.
+bool MAX17263::loadCustomModel(const MAX17263CustomModel *model) {
+    uint32_t start = clock->micros();
+    uint32_t checksum = pgm_read_dword(&model->checksum), chipChecksum;
+    bool same;
+    modelUploadSkipped = checksum && unlockModel(true) && readModelTable(0, same, chipChecksum) && chipChecksum == checksum;
+    modelVerified = modelUploadSkipped;
+    for (byte attempt = 0; !modelVerified && attempt < 3; attempt++) {
+        modelVerified = unlockModel(true) && writeModelTable(model->table) &&
+                        readModelTable(model->table, same, chipChecksum) && same;
+    }
+    // Lock, the locked model table reads as zeros
+    bool locked = false;
+    for (byte attempt = 0; !locked && attempt < 3; attempt++) {
+        locked = unlockModel(false) && readModelTable(0, same, chipChecksum) && same;
+    }
+    modelVerified &= locked;
+    bool ok = modelVerified;
+    if (ok && !modelUploadSkipped) { // keep the learned RComp0 and TempCo of a model that is in place
+        uint16_t rComp0TempCo[2] = {pgm_read_word(&model->rComp0), pgm_read_word(&model->tempCo)};
+        ok = writeRegs(regRComp0, rComp0TempCo, 2);
+        for (byte i = 0; ok && i < 4; i++) {
+            ok = writeReg16Bit(regQRTable00 + 0x10 * i, pgm_read_word(&model->qrTable[i]));
+        }
+        forceModelRefresh = ok;
+    }
+    modelUpload_us = clock->micros() - start;
+    return ok;
+}
+
+// Write the model table from flash, MAX17263_MODEL_CHUNK words per burst
+bool MAX17263::writeModelTable(const uint16_t *table) {
+    uint16_t chunk[MAX17263_MODEL_CHUNK];
+    for (byte i = 0; i < MAX17263_MODEL_SIZE; i += MAX17263_MODEL_CHUNK) {
+        byte n = min(MAX17263_MODEL_CHUNK, MAX17263_MODEL_SIZE - i);
+        memcpy_P(chunk, table + i, 2 * n);
+        if (!writeRegs(regModelTable + i, chunk, n)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-// Exit hibernate mode
+// Read the chip model table, false on a bus error. same tells if it equals table (in flash),
+// or is all zeros when table is 0, checksum gets the MAX17263ModelChecksum of the chip words.
+bool MAX17263::readModelTable(const uint16_t *table, bool &same, uint32_t &checksum) {
+    uint16_t chip[MAX17263_MODEL_CHUNK], expected[MAX17263_MODEL_CHUNK];
+    uint32_t sum1 = 0, sum2 = 0;
+    same = true;
+    for (byte i = 0; i < MAX17263_MODEL_SIZE; i += MAX17263_MODEL_CHUNK) {
+        byte n = min(MAX17263_MODEL_CHUNK, MAX17263_MODEL_SIZE - i);
+        if (!readRegs(regModelTable + i, chip, n)) {
+            return false;
+        }
+        if (table) {
+            memcpy_P(expected, table + i, 2 * n);
+        } else {
+            memset(expected, 0, 2 * n);
+        }
+        same &= !memcmp(chip, expected, 2 * n);
+        for (byte k = 0; k < n; k++) {
+            sum1 = (sum1 + chip[k]) % 65535;
+            sum2 = (sum2 + sum1) % 65535;
+        }
+    }
+    checksum = sum2 << 16 | sum1;
+    return true;
+}
+
+// Unlock or lock the access to the model table, both lock registers in one burst
+bool MAX17263::unlockModel(bool unlock) {
+    uint16_t lock[2] = {0x0000, 0x0000};
+    if (unlock) {
+        lock[0] = 0x0059;
+        lock[1] = 0x00C4;
+    }
+    return writeRegs(regModelLock1, lock, 2);
+}
+
+// Exit hibernate mode, UG6595 page 7
 void MAX17263::exitHibernate() {
-    // Write to HibCfg register to exit hibernate
+    writeReg16Bit(regCommand, 0x0090); // Soft-wakeup command
     writeReg16Bit(regHibCfg, 0x0000);
-    
-    // Write to Status register to wake up
-    writeReg16Bit(regStatus, 0x0000);
-    
-    delay(10); // Allow time to wake up
+    writeReg16Bit(regCommand, 0x0000); // Clear the command
 }
 
-// Store original hibernate configuration
-void MAX17263::storeHibernateCFG() {
-    originalHibernateCFG = readReg16Bit(regHibCfg);
+// Store original hibernate configuration, false on a bus error
+bool MAX17263::storeHibernateCFG() {
+    return readRegs(regHibCfg, &originalHibernateCFG, 1);
 }
 
 // Restore hibernate configuration
@@ -277,43 +903,189 @@ void MAX17263::restoreHibernateCFG() {
     writeReg16Bit(regHibCfg, originalHibernateCFG);
 }
 
-// Configure LED settings 1
-void MAX17263::setLEDCfg1() {
-    // Example LED configuration - adjust as needed
-    // Enable LED, set timing and thresholds
-    uint16_t ledCfg1 = 0x0570; // Example value
-    writeReg16Bit(regLedCfg1, ledCfg1);
+// Update period of the registers the getters read, a read within this time returns the same data
+#define MAX17263_CACHED(name) {MAX17263Reg##name::address, MAX17263Reg##name::period_ms}
+static const struct { byte reg; uint16_t ttl_ms; } cacheTTL[MAX17263_CACHE_SIZE] = {
+    MAX17263_CACHED(VCell), MAX17263_CACHED(Current), MAX17263_CACHED(AvgVCell), MAX17263_CACHED(AvgCurrent),
+    MAX17263_CACHED(Temp), MAX17263_CACHED(RepSOC), MAX17263_CACHED(RepCap), MAX17263_CACHED(TimeToEmpty)
+};
+
+// Read a register of the getters, through the cache when readCache is set.
+// If the bus fails, the last good value is returned and dataStale is set.
+uint16_t MAX17263::readCached(byte reg) {
+    for (byte i = 0; i < MAX17263_CACHE_SIZE; i++) {
+        if (cacheTTL[i].reg != reg) {
+            continue;
+        }
+        uint32_t now = clock->millis();
+        bool valid = cacheValid & (1 << i);
+        if (readCache && valid && (uint32_t)(now - cacheTime[i]) < cacheTTL[i].ttl_ms) {
+            cacheStats.hits++;
+            dataStale = false; // a good value, a bus error of an earlier read does not taint it
+            return cacheValue[i];
+        }
+        if (readCache) {
+            cacheStats.misses++;
+        }
+        uint16_t value;
+        dataStale = !readRegs(reg, &value, 1);
+        if (dataStale) {
+            busStats.fallbacks++;
+            return valid ? cacheValue[i] : 0xFFFF;
+        }
+        cacheValue[i] = value;
+        cacheTime[i] = now;
+        cacheValid |= 1 << i;
+        return value;
+    }
+    uint16_t value; // a register without TTL is always read
+    dataStale = !readRegs(reg, &value, 1);
+    if (dataStale) {
+        busStats.fallbacks++;
+        return 0xFFFF;
+    }
+    return value;
 }
 
-// Configure LED settings 2
-void MAX17263::setLEDCfg2() {
-    // Example LED configuration - adjust as needed
-    uint16_t ledCfg2 = 0x0000; // Example value
-    writeReg16Bit(regLedCfg2, ledCfg2);
+// Forget all cached values, e.g. after a power on reset
+void MAX17263::clearReadCache() {
+    cacheValid = 0;
+    chipTimerHKnown = false; // Timer restarts at POR
 }
 
-// Read 16-bit register
+// Read 16-bit register, 0xFFFF on a bus error
 uint16_t MAX17263::readReg16Bit(byte reg) {
-    Wire.beginTransmission(I2CAddress);
-    Wire.write(reg);
-    Wire.endTransmission(false);
-    
-    Wire.requestFrom(I2CAddress, (byte)2);
-    
-    uint16_t value = 0;
-    if (Wire.available() >= 2) {
-        value = Wire.read();
-        value |= (uint16_t)Wire.read() << 8;
+    uint16_t value;
+    return readRegs(reg, &value, 1) ? value : 0xFFFF;
+}
+
+// Burst read with bounded retries, gives up when busRetries or the busBudget_us latency budget is used up
+bool MAX17263::readRegs(byte reg, uint16_t *values, byte count) {
+    uint32_t start = clock->micros();
+    for (byte attempt = 0; retry(attempt, start); attempt++) {
+        if (bus->readRegs(I2CAddress, reg, values, count)) {
+            return true;
+        }
     }
-    
-    return value;
+    busStats.readErrors++;
+    return false;
+}
+
+// True if attempt may start: the first one always, retries within busRetries and busBudget_us
+bool MAX17263::retry(byte attempt, uint32_t start_us) {
+    if (attempt == 0) {
+        return true;
+    }
+    if (attempt > busRetries) {
+        return false;
+    }
+    if ((uint32_t)(clock->micros() - start_us) > busBudget_us) {
+        busStats.budgetExceeded++;
+        return false;
+    }
+    busStats.retries++;
+    return true;
+}
+
+// Write 16-bit register with bounded retries, returns false on a bus error
+bool MAX17263::writeReg16Bit(byte reg, uint16_t value) {
+    return writeRegs(reg, &value, 1);
+}
+
+// Burst write with bounded retries
+bool MAX17263::writeRegs(byte reg, const uint16_t *values, byte count) {
+    for (byte i = 0; i < MAX17263_CACHE_SIZE; i++) {
+        if ((byte)(cacheTTL[i].reg - reg) < count) {
+            cacheValid &= ~(1 << i);
+        }
+    }
+    uint32_t start = clock->micros();
+    for (byte attempt = 0; retry(attempt, start); attempt++) {
+        if (bus->writeRegs(I2CAddress, reg, values, count)) {
+            return true;
+        }
+    }
+    busStats.writeErrors++;
+    return false;
+}
+
+#ifdef ARDUINO
+
+MAX17263WireBus MAX17263Wire;
+
+// Burst read, split into requests that fit the Wire buffer
+bool MAX17263WireBus::readRegs(byte address, byte reg, uint16_t* values, byte count) {
+    while (count) {
+        byte n = min(count, (byte)(MAX17263_WIRE_BUFFER / 2));
+        wire.beginTransmission(address);
+        wire.write(reg);
+        if (wire.endTransmission(false) != 0) {
+            return false; // NAK on address or register
+        }
+        wire.requestFrom(address, (byte)(2 * n));
+        if (wire.available() < 2 * n) {
+            return false;
+        }
+        for (byte i = 0; i < n; i++) {
+            values[i] = wire.read();
+            values[i] |= (uint16_t)wire.read() << 8;
+        }
+        reg += n;
+        values += n;
+        count -= n;
+    }
+    return true;
+}
+
+// Burst write, LSB first, split into transactions that fit the Wire buffer
+bool MAX17263WireBus::writeRegs(byte address, byte reg, const uint16_t* values, byte count) {
+    while (count) {
+        byte n = min(count, (byte)((MAX17263_WIRE_BUFFER - 1) / 2));
+        wire.beginTransmission(address);
+        wire.write(reg);
+        for (byte i = 0; i < n; i++) {
+            wire.write(values[i] & 0xFF);        // LSB
+            wire.write((values[i] >> 8) & 0xFF); // MSB
+        }
+        if (wire.endTransmission() != 0) {
+            return false;
+        }
+        reg += n;
+        values += n;
+        count -= n;
+    }
+    return true;
+}
+
+#if defined(SDA) && defined(SCL)
+// Clock SCL until the target releases SDA, then a STOP, with the pins as open drain outputs
+bool MAX17263WireBus::clearBus() {
+    if (&wire != &Wire) {
+        return false; // the pins of other TwoWire instances are not known
+    }
+    wire.end();
+    pinMode(SDA, INPUT_PULLUP);
+    pinMode(SCL, INPUT_PULLUP);
+    for (byte i = 0; i < 9 && digitalRead(SDA) == LOW; i++) {
+        pinMode(SCL, OUTPUT);
+        digitalWrite(SCL, LOW);
+        delayMicroseconds(5); // 100kHz
+        pinMode(SCL, INPUT_PULLUP);
+        delayMicroseconds(5);
+    }
+    bool released = digitalRead(SDA) == HIGH;
+    pinMode(SDA, OUTPUT); // STOP: SDA rises while SCL is high
+    digitalWrite(SDA, LOW);
+    delayMicroseconds(5);
+    pinMode(SDA, INPUT_PULLUP);
+    delayMicroseconds(5);
+    wire.begin();
+    return released;
+}
+#else
+bool MAX17263WireBus::clearBus() {
+    return false;
 }
+#endif
 
-// Write 16-bit register
-void MAX17263::writeReg16Bit(byte reg, uint16_t value) {
-    Wire.beginTransmission(I2CAddress);
-    Wire.write(reg);
-    Wire.write(value & 0xFF);        // LSB
-    Wire.write((value >> 8) & 0xFF); // MSB
-    Wire.endTransmission();
-}
\ No newline at end of file
+#endif
@@ -6,35 +6,217 @@ MIT License terugzetten
 #define MAX17263_h
 
 #include <Arduino.h>
+#include "MAX17263Bus.h"
+#include "MAX17263Clock.h"
+#include "MAX17263Registers.h"
+
+// Production test steps, UG6365 MAX17055 Software Implementation Guide page 12
+enum MAX17263ProductionTestStep : byte
+{ testIdle,
+  testQuickstart,     // Step T1 set the Quickstart and Verify bits, check the Verify bit
+  testWaitQuickstart, // Step T2 wait until MiscCfg.QS and FStat.DNR are cleared
+  testVerifyOutputs,  // Step T3 read RepCap and RepSOC and check their range
+  testDone
+};
+
+struct MAX17263ProductionTestResult
+{ bool pass;
+  MAX17263ProductionTestStep failedStep; // testIdle if pass
+  byte quickstartAttempts;
+  uint16_t stepDuration_ms[3]; // T1, T2, T3
+  uint16_t total_ms;
+  uint16_t repCapRaw, repSOCRaw;
+  float repCap_mAh, repSOC;
+};
+
+#define MAX17263_CACHE_SIZE 8 // registers read by the getters
+
+struct MAX17263BusStats
+{ uint32_t readErrors, writeErrors; // transactions that failed after all retries
+  uint32_t retries, budgetExceeded, fallbacks; // fallbacks: last good value returned
+  uint32_t busClears; // recoverBus() that freed the bus
+};
+
+// Why the last initialize() failed
+enum MAX17263Fault : byte
+{ faultNone,
+  faultBus,          // no answer after all retries: NAK, short read or a bus held low
+  faultDataNotReady, // FStat.DNR not cleared within readyTimeout_ms
+  faultRefresh,      // ModelCfg.Refresh not cleared within readyTimeout_ms
+  faultQuickstart,   // MiscCfg.QS not cleared within readyTimeout_ms
+  faultConfig,       // the configuration did not read back
+  faultModel         // the custom model upload did not verify or lock, the EZ configuration is not written
+};
+
+struct MAX17263CacheStats
+{ uint32_t hits, misses;
+};
+
+// Quantities for change subscriptions
+enum MAX17263Quantity : byte
+{ quantitySOC,         // %
+  quantityCapacity,    // mAh
+  quantityVCell,       // V
+  quantityCurrent,     // mA
+  quantityTemp,        // degree Celsius
+  quantityTimeToEmpty, // hours
+  quantityAvgVCell,    // V
+  quantityPower,       // mW
+  quantityAvgPower,    // mW
+  quantityAvgCurrent,  // mA
+  quantityTimeToFull,  // hours
+  quantityFullCapRep,  // mAh
+  quantityFullCapNom,  // mAh
+  quantityCycles,      // full cycles
+  quantityAge,         // %, FullCapRep / DesignCap
+  quantityAvgTA,       // degree Celsius, long term average temperature
+  quantityQH           // mAh, coulomb counter, negative when discharged
+};
+
+typedef void (*MAX17263ChangeCallback)(MAX17263Quantity quantity, float value, void *context);
+
+#ifndef MAX17263_MAX_SUBSCRIPTIONS
+#define MAX17263_MAX_SUBSCRIPTIONS 4
+#endif
+
+struct MAX17263Subscription
+{ MAX17263ChangeCallback callback; // 0 = free
+  void *context;
+  MAX17263Quantity quantity;
+  int8_t lastDirection; // +1 or -1 after the first change
+  uint16_t delta, hysteresis; // raw LSBs
+  uint16_t published; // raw word of the last callback
+};
+
+#define MAX17263_CONFIG_SIZE 7 // entries of the EZ configuration image
+
+// Register of a configuration image, only the mask bits are written, the other bits keep their chip value
+struct MAX17263ConfigEntry
+{ byte reg;
+  uint16_t value, mask;
+};
+
+#define MAX17263_MODEL_SIZE 48 // words of the model table, registers 0x80..0xAF
+#ifndef MAX17263_MODEL_CHUNK
+#define MAX17263_MODEL_CHUNK 12 // words copied from flash per burst, 25 bytes fit the AVR Wire buffer
+#endif
+
+// Custom model from the cell characterisation (INI file), UG6595 Step 2.2 Option 3.
+// DesignCap, IchgTerm, VEmpty and ModelCfg still come from the battery parameters.
+// Lives in PROGMEM, generated by extras/host/model_compiler.cpp.
+struct MAX17263CustomModel
+{ uint16_t table[MAX17263_MODEL_SIZE]; // OCV table and cell data, 0x80..0xAF
+  uint16_t rComp0, tempCo; // 0x38, 0x39
+  uint16_t qrTable[4]; // QRTable00..30, 0x12, 0x22, 0x32, 0x42
+  uint32_t checksum; // MAX17263ModelChecksum of table, 0 = always upload
+};
+
+// Fletcher-32 of the model table, constexpr so generated models are checked at compile time
+constexpr uint32_t MAX17263ModelChecksum(const uint16_t *words, byte count, uint32_t sum1 = 0, uint32_t sum2 = 0)
+{ return count == 0 ? sum2 << 16 | sum1
+                    : MAX17263ModelChecksum(words + 1, count - 1, (sum1 + words[0]) % 65535, (sum2 + sum1 + words[0]) % 65535);
+}
+
+// Raw register words of one moment, the first six are read in one burst
+struct MAX17263Snapshot
+{ uint16_t repCap, repSOC, age, temp, vCell, current; // 0x05..0x0A
+  uint16_t timeToEmpty, avgVCell;
+  uint16_t timer, timerH; // chip time right after the burst, LSB 175.8ms and 3.2 hours, restarts at POR
+  uint32_t time_ms; // millis() of the burst
+};
+
+// Register groups of MAX17263Measurements, each one burst sized to the register layout
+enum MAX17263Group : byte
+{ groupGauge   = 0x01, // 0x05..0x0B RepCap, RepSOC, Age, Temp, VCell, Current, AvgCurrent
+  groupHistory = 0x02, // 0x10..0x1C FullCapRep, TimeToEmpty .. Cycles, DesignCap, AvgVCell, MaxMin*
+  groupFull    = 0x04, // 0x20..0x23 TimeToFull .. FullCapNom
+  groupQH      = 0x08, // 0x4D
+  groupTimer   = 0x10, // 0x3E Timer and 0xBE TimerH, two transactions
+  groupAll     = 0x1F
+};
+
+// Raw register words of the groups, the members of a group are in register order, so a burst
+// is read straight into them. Convert with MAX17263::convert() and convertMaxMin().
+struct MAX17263Measurements
+{ uint16_t repCap, repSOC, age, temp, vCell, current, avgCurrent; // groupGauge
+  uint16_t fullCapRep, timeToEmpty, qrTable00, fullSocThr, rCell, rFast, avgTA, cycles, designCap, avgVCell,
+           maxMinTemp, maxMinVolt, maxMinCurr; // groupHistory
+  uint16_t timeToFull, devName, qrTable10, fullCapNom; // groupFull
+  uint16_t qh; // groupQH
+  uint16_t timer, timerH; // groupTimer
+  byte valid; // MAX17263Group bits of the groups read
+  uint32_t time_ms; // millis() of the first burst
+};
+
+// Learned parameters to save when Cycles bit 2 toggles, UG6595 Step 3.5
+struct MAX17263LearnedParams
+{ uint16_t rComp0, tempCo, fullCapRep, cycles, fullCapNom;
+};
 
 class MAX17263
 {
 public:  
-  const byte regStatus      = 0x00; // UG6597 page 32 Flags related to alert thresholds and battery insertion or removal
-  const byte regModelCfg    = 0xdb; // UG6597 page 29 Basic options of the EZ algorithm.
-  const byte regVCell       = 0x09; // VCell reports the voltage measured between BATT and CSP
-  const byte regAvgVCell    = 0x19; // The AvgVCell register reports an average of the VCell register readings. 
-  const byte regCurrent     = 0x0A; // Voltage between the CSP and CSN pins, and would need to convert to current
-  const byte regAvgCurrent  = 0x0B; // The AvgCurrent register reports an average of Current register readings
-  const byte regRepSOC      = 0x06; // The Reported State of Charge of connected battery. 
-  const byte regTimeToEmpty = 0x11; // How long before battery is empty (in ms).  
-  const byte regRepCap      = 0x05; // Reported Capacity. 
-  const byte regDesignCap   = 0x18; // Capacity of battery inserted, not typically used for user requested capacity
-  const byte regTemp        = 0x08; // Temperature
-  const byte regFStat       = 0x3D; // Status of the ModelGauge m5 algorithm
-  const byte regIchgTerm    = 0x1E; // Charge termination current default 0x0640 (250mA on 10mΩ) UG6597 page 29
-  const byte regVEmpty      = 0x3A; // 9bit, Empty voltage target, during load, 0...5.11V, default 3.3V UG6597 page 28
-  const byte regHibCfg      = 0xBA; // hibernate mode functionality UG6597 page 41
-  const byte regLedCfg1     = 0x40;
-  const byte regLedCfg2     = 0x4B;
-  const byte regMiscCfg     = 0x2B; // enables various other functions UG6597 page 36
-  const byte regLedCfg3     = 0x37; // not used
-  const byte regCustLED     = 0x64; // not used 
+  // Register addresses, taken from the descriptors of MAX17263Registers.h, the one source of the register map
+  const byte regStatus      = MAX17263RegStatus::address; // UG6597 page 32 Flags related to alert thresholds and battery insertion or removal
+  const byte regModelCfg    = MAX17263RegModelCfg::address; // UG6597 page 29 Basic options of the EZ algorithm.
+  const byte regVCell       = MAX17263RegVCell::address; // VCell reports the voltage measured between BATT and CSP
+  const byte regAvgVCell    = MAX17263RegAvgVCell::address; // The AvgVCell register reports an average of the VCell register readings. 
+  const byte regCurrent     = MAX17263RegCurrent::address; // Voltage between the CSP and CSN pins, and would need to convert to current
+  const byte regAvgCurrent  = MAX17263RegAvgCurrent::address; // The AvgCurrent register reports an average of Current register readings
+  const byte regRepSOC      = MAX17263RegRepSOC::address; // The Reported State of Charge of connected battery. 
+  const byte regTimeToEmpty = MAX17263RegTimeToEmpty::address; // How long before battery is empty (in ms).  
+  const byte regRepCap      = MAX17263RegRepCap::address; // Reported Capacity. 
+  const byte regDesignCap   = MAX17263RegDesignCap::address; // Capacity of battery inserted, not typically used for user requested capacity
+  const byte regTemp        = MAX17263RegTemp::address; // Temperature
+  const byte regFStat       = MAX17263RegFStat::address; // Status of the ModelGauge m5 algorithm
+  const byte regConfig      = MAX17263RegConfig::address; // alert enables, UG6597 page 31
+  const byte regIchgTerm    = MAX17263RegIchgTerm::address; // Charge termination current default 0x0640 (250mA on 10mΩ) UG6597 page 29
+  const byte regVEmpty      = MAX17263RegVEmpty::address; // 9bit, Empty voltage target, during load, 0...5.11V, default 3.3V UG6597 page 28
+  const byte regHibCfg      = MAX17263RegHibCfg::address; // hibernate mode functionality UG6597 page 41
+  const byte regLedCfg1     = MAX17263RegLedCfg1::address;
+  const byte regLedCfg2     = MAX17263RegLedCfg2::address;
+  const byte regMiscCfg     = MAX17263RegMiscCfg::address; // enables various other functions UG6597 page 36
+  const byte regLedCfg3     = MAX17263RegLedCfg3::address; // not used
+  const byte regCustLED     = MAX17263RegCustLED::address; // not used 
+  const byte regRComp0      = MAX17263RegRComp0::address; // learned parameters UG6595 page 11
+  const byte regTempCo      = MAX17263RegTempCo::address;
+  const byte regFullCapRep  = MAX17263RegFullCapRep::address;
+  const byte regCycles      = MAX17263RegCycles::address;
+  const byte regFullCapNom  = MAX17263RegFullCapNom::address;
+  const byte regPower       = MAX17263RegPower::address; // VCell x Current of the last conversion, LSB 8uV^2/rSense, signed
+  const byte regAvgPower    = MAX17263RegAvgPower::address; // filtered Power
+  const byte regModelTable  = MAX17263RegModelTable::address; // custom model, MAX17263_MODEL_SIZE words, UG6595 page 8
+  const byte regModelLock1  = MAX17263RegModelLock1::address; // model access 0x0059/0x00C4 unlocks, 0x0000/0x0000 locks
+  const byte regModelLock2  = MAX17263RegModelLock2::address;
+  const byte regQRTable00   = MAX17263RegQRTable00::address; // QRTable10..30 follow every 0x10
+  const byte regAge         = MAX17263RegAge::address; // FullCapRep / DesignCap, LSB 1/256 %
+  const byte regAvgTA       = MAX17263RegAvgTA::address; // long term average temperature
+  const byte regMaxMinTemp  = MAX17263RegMaxMinTemp::address; // max in the high byte, min in the low byte, since the last reset
+  const byte regMaxMinVolt  = MAX17263RegMaxMinVolt::address;
+  const byte regMaxMinCurr  = MAX17263RegMaxMinCurr::address;
+  const byte regTimeToFull  = MAX17263RegTimeToFull::address;
+  const byte regQH          = MAX17263RegQH::address; // coulomb counter, LSB as RepCap, signed
+  const byte regTimer       = MAX17263RegTimer::address; // LSB 175.8ms, rolls over after 3.2 hours
+  const byte regTimerH      = MAX17263RegTimerH::address; // LSB 3.2 hours
+  const byte regCommand     = MAX17263RegCommand::address; // soft-wakeup 0x0090, UG6595 page 7
 
+  void begin(MAX17263Bus &bus); // optional on Arduino, the default bus is Wire
+  void begin(MAX17263Bus &bus, MAX17263Clock &clock); // e.g. a virtual clock for tests
   bool batteryPresent();
   bool powerOnResetEvent();
-  void initialize();
-  void productionTest();
+  bool batterySwapEvent(); // Status.BI, a battery was inserted since the last (re)initialization
+  uint16_t getStatus(); // one read for all Status flags, on a bus error the last good value without POR
+  bool initialize(); // false on a fault, see fault
+  bool reinitializeAfterSwap(); // after batterySwapEvent(), only what a swap invalidates, false on a fault
+  byte configurationImage(MAX17263ConfigEntry *image); // what initialize() writes for the parameters below, entries returned
+  uint16_t configSelfClearing(byte reg); // bits of an image register the chip clears by itself
+  bool configNeedsRefresh(byte reg); // a change of the register must be loaded with ModelCfg.Refresh
+  void clearBatteryRemoval(); // Status.BR, with swapAlert it releases ALRT, so the insertion asserts it again
+  bool recoverBus(); // clear a bus held low by the gauge, done by the status checks after a bus error
+  bool productionTest(); // blocking, runs the steps below until done, returns pass
+  void startProductionTest();
+  bool productionTestBusy(); // non-blocking, call from loop() until it returns false
+  MAX17263ProductionTestResult productionTestResult;
   float getCurrent();
   float getVcell();
   float getCapacity_mAh();
@@ -42,40 +224,134 @@ public:
   float getTimeToEmpty();
   float getTemp(); 
   float getAvgVCell(); 
+  float getPower_mW(); // positive while charging, like getCurrent()
+  float getAvgPower_mW();
+  float getQuantity(MAX17263Quantity quantity); // any quantity in the units of convert(), through the read cache
+  bool accumulateEnergy(); // call from loop(), integrates AvgPower every energyInterval_ms, false on a bus error
+  int32_t getEnergy_mWh(); // since resetEnergy(), integer arithmetic, negative when discharged
+  void resetEnergy();
+  // Typed access to one bit field of MAX17263Registers.h, e.g. readField<MAX17263ModelCfgModelID>()
+  template<typename F> uint16_t readField() { return F::get(readReg16Bit(F::reg::address)); }
+  template<typename F> bool writeField(uint16_t value) { // read-modify-write, the other bits are kept
+    uint16_t word;
+    return readRegs(F::reg::address, &word, 1) && writeReg16Bit(F::reg::address, (word & ~F::mask) | F::bits(value));
+  }
+  void clearReadCache();
+  bool readSnapshot(MAX17263Snapshot &snapshot);
+  bool readMeasurements(MAX17263Measurements &m, byte groups = groupAll); // one burst per group, false on a bus error
+  float convert(MAX17263Quantity quantity, uint16_t raw); // raw register word to the getter units
+  // MaxMinVolt, MaxMinCurr or MaxMinTemp word for quantityVCell, quantityCurrent or quantityTemp
+  float convertMaxMin(MAX17263Quantity quantity, uint16_t raw, bool max);
+  bool learnedParamsDue(); // Cycles bit 2 toggled since the last save
+  bool saveLearnedParams(MAX17263LearnedParams &params);
+  bool dumpAll(uint16_t *regs); // 256 entries, burst read per range of dumpRanges, the gaps (see there) stay 0
+  // Call callback when quantity changed more than delta since the last callback, a change in the
+  // opposite direction must be larger than delta + hysteresis. Units as the getters. Needs rSense.
+  bool subscribe(MAX17263Quantity quantity, float delta, float hysteresis, MAX17263ChangeCallback callback, void *context = 0);
+  void unsubscribe(MAX17263ChangeCallback callback);
+  void publishChanges(); // call periodically, compares raw register words and fires the callbacks
 
   byte modelID; 
   bool refresh, r100, vChg; 
   float rSense, vEmpty;
+  bool swapAlert = false; // ALRT on battery insertion and removal (Config.Bei, Ber, Aen), part of the configuration
   long designCap_mAh;
   uint16_t ichgTerm;
+  const MAX17263CustomModel *customModel = 0; // in PROGMEM, uploaded by initialize() instead of the EZ model, optional
+  uint16_t productionTestTimeout_ms = 1500; // Step T2 bound, Quickstart normally takes < 1s
+  float productionTestMinSOC = 1, productionTestMaxSOC = 100; // Step T3 limits, depend on the battery voltage of the fixture
+  bool readCache = false; // getters skip the bus while the register cannot have changed, see cacheTTL
+  MAX17263CacheStats cacheStats = {0, 0};
+  byte busRetries = 2; // extra attempts after a NAK or short read
+  uint16_t busBudget_us = 3000; // no retry after this time, about 6 register reads at 100kHz
+  MAX17263BusStats busStats = {0, 0, 0, 0, 0, 0};
+  bool modelRefreshSkipped = false; // last initialize() found the configuration still in place
+  bool configVerified = false; // last initialize() read the whole configuration image back
+  uint16_t initialize_ms = 0; // duration of the last initialize()
+  MAX17263Fault fault = faultNone; // of the last initialize() or reinitializeAfterSwap()
+  uint16_t reinitialize_ms = 0; // duration of the last reinitializeAfterSwap()
+  uint16_t readyTimeout_ms = 1000; // FStat.DNR, ModelCfg.Refresh and MiscCfg.QS waits, a bus error ends them at once
+  uint16_t energyInterval_ms = 1000; // accumulateEnergy() sample period
+  int64_t energy_raw_ms = 0; // sum of AvgPower x ms, exact, so no drift over months
+  uint32_t energyMaxGap_ms = 60000; // a longer time between two samples is integrated as this long
+  uint32_t energyGaps = 0; // samples that were capped at energyMaxGap_ms, the energy misses part of the gap
+  bool modelVerified = false; // last custom model upload read back and locked
+  bool modelUploadSkipped = false; // the chip already had the custom model, checksum matched
+  uint32_t modelUpload_us = 0; // duration of the last custom model upload, without the refresh
+  bool dataStale = false; // the last getter returned the last good value (raw 0xFFFF without one) because of a bus error
   
 private:
   const byte I2CAddress = 0x36;
+#ifdef ARDUINO
+  MAX17263Bus *bus = &MAX17263Wire;
+#else
+  MAX17263Bus *bus = 0; // host: set with begin()
+#endif
+  MAX17263Clock *clock = &MAX17263System;
   uint16_t originalHibernateCFG;
+  MAX17263ProductionTestStep testStep = testIdle;
+  uint32_t testStart_ms, testStepStart_ms, testPoll_ms;
+  uint16_t cacheValue[MAX17263_CACHE_SIZE];
+  uint32_t cacheTime[MAX17263_CACHE_SIZE];
+  byte cacheValid = 0; // bit per cacheTTL entry
+  MAX17263Subscription subscriptions[MAX17263_MAX_SUBSCRIPTIONS] = {};
+  uint16_t savedCycles = 0;
+  uint16_t lastStatus = 0x0008; // BSt, no battery until the first good read
+  uint32_t energyTime_ms; // last accumulateEnergy() sample
+  uint16_t lastTimer, chipTimerH; // TimerH is counted from the Timer roll overs, see readChipTime()
+  uint32_t lastTimer_ms;
+  bool chipTimerHKnown = false;
+  bool energyStarted = false;
    
-  uint16_t getStatus(); 
   float capacity_multiplier_mAH; // depends on rSense
   float current_multiplier_mV; // depends on rSense
-  const float voltage_multiplier_V = 7.8125e-5; // UG6595 page 4
-  const float time_multiplier_Hours = 5.625/3600.0; // UG6595 page 10, lsb = 5.625 seconds
-  const float SOC_multiplier = 1.0/256.0; // UG6595 page 4
+  float power_multiplier_mW; // depends on rSense
+  const float voltage_multiplier_V = MAX17263RegVCell::lsb(); // UG6595 page 4
+  const float time_multiplier_Hours = MAX17263RegTimeToEmpty::lsb(); // UG6595 page 10, lsb = 5.625 seconds
+  const float SOC_multiplier = MAX17263RegRepSOC::lsb(); // UG6595 page 4
+  const uint16_t ledCfg1Value = 0x0570; // Example value, enable LED, set timing and thresholds
+  const uint16_t ledCfg2Value = 0x0000; // Example value
+  MAX17263ConfigEntry configImage[MAX17263_CONFIG_SIZE];
+  byte configImageSize = 0;
+  bool forceModelRefresh = false; // a custom model was uploaded, ModelCfg.Refresh must load it
 
+  bool waitForClear(byte reg, uint16_t mask, MAX17263Fault timeoutFault);
   bool waitForDNRdataNotReady();
-  void clearPORpowerOnReset();
+  bool clearPORpowerOnReset();
   void calcMultipliers(float rSense); 
-  void setDesignCap_mAh(long c); 
-  void setIchgTerm(uint16_t i);
-  void setVEmpty(float vf);
-  void refreshModelCFG(bool r100, bool vChg, byte modelID);
+  void buildConfigImage();
+  bool readImage(const MAX17263ConfigEntry *image, byte size, uint16_t *current);
+  bool writeImage(const MAX17263ConfigEntry *image, byte size, const uint16_t *current, uint32_t dirty);
+  bool verifyConfigImage();
   bool waitforModelCFGrefreshReady();
+  bool quickstart();
   void setEZconfig();
+  bool loadCustomModel(const MAX17263CustomModel *model);
+  bool writeModelTable(const uint16_t *table);
+  bool readModelTable(const uint16_t *table, bool &same, uint32_t &checksum);
+  bool unlockModel(bool unlock);
+  // per-register setters of the Arduino-MAX17263_Driver.ino variant
+  bool setDesignCap_mAh(long c); // the setters return false on a bus error
+  bool setIchgTerm(uint16_t i);
+  bool setVEmpty(float vf);
+  bool refreshModelCFG(bool r100, bool vChg, byte modelID);
+  bool setLEDCfg1();
+  bool setLEDCfg2();
   void exitHibernate();
-  void storeHibernateCFG();
+  bool storeHibernateCFG();
   void restoreHibernateCFG();
-  void setLEDCfg1();
-  void setLEDCfg2();
+  void endProductionTestStep(MAX17263ProductionTestStep next);
+  void failProductionTest();
+  bool readChipTime(uint16_t &timer, uint16_t &timerH);
+  byte quantityReg(MAX17263Quantity quantity);
+  bool quantitySigned(MAX17263Quantity quantity);
+  float quantityLSB(MAX17263Quantity quantity);
+  uint16_t readCached(byte reg);
   uint16_t readReg16Bit(byte reg);
-  void writeReg16Bit(byte reg, uint16_t value);
+  bool readRegs(byte reg, uint16_t *values, byte count);
+  bool retry(byte attempt, uint32_t start_us);
+  bool writeReg16Bit(byte reg, uint16_t value);
+  bool writeRegs(byte reg, const uint16_t *values, byte count);
 };
 
 #endif
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Asynchronous transaction queue for the MAX17263 bus, see MAX17263Async.h
+*/
+
+#include "MAX17263Async.h"
+
+void MAX17263Transaction::prepareRead(byte reg, uint16_t *values, byte count, MAX17263Completion callback, void *context) {
+    this->reg = reg;
+    this->values = values;
+    this->count = count;
+    this->write = false;
+    this->callback = callback;
+    this->context = context;
+}
+
+void MAX17263Transaction::prepareWrite(byte reg, uint16_t *values, byte count, MAX17263Completion callback, void *context) {
+    prepareRead(reg, values, count, callback, context);
+    this->write = true;
+}
+
+void MAX17263BlockingBackend::start(byte address, MAX17263Transaction &t) {
+    result = t.write ? bus.writeRegs(address, t.reg, t.values, t.count)
+                     : bus.readRegs(address, t.reg, t.values, t.count);
+}
+
+// Append t to the queue, it is started by service()
+bool MAX17263AsyncBus::submit(MAX17263Transaction &t) {
+    if (t.state == transactionQueued || t.state == transactionActive) {
+        return false;
+    }
+    t.state = transactionQueued;
+    t.next = 0;
+    if (tail) {
+        tail->next = &t;
+    } else {
+        head = &t;
+    }
+    tail = &t;
+    return true;
+}
+
+// Finish the active transaction and start the next one
+void MAX17263AsyncBus::service() {
+    while (head) {
+        MAX17263Transaction &t = *head;
+        if (t.state == transactionQueued) {
+            t.state = transactionActive;
+            backend.start(address, t);
+        }
+        bool ok;
+        if (!backend.complete(t, ok)) {
+            return; // still on the wire
+        }
+        head = t.next;
+        if (!head) {
+            tail = 0;
+        }
+        t.state = ok ? transactionDone : transactionFailed;
+        if (ok) {
+            completed++;
+        } else {
+            failed++;
+        }
+        if (t.callback) {
+            t.callback(t, t.context); // may submit t again
+        }
+    }
+}
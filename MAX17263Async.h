@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Asynchronous transaction queue for the MAX17263 bus.
+The caller owns the transactions (no heap, no fixed queue size), queues them with submit()
+and gets a completion callback, or polls the transaction like a future with ready().
+service() must be called from loop(), it starts the next transaction and runs the callbacks,
+so callbacks never run in interrupt context.
+
+The overlap depends on the backend: MAX17263BlockingBackend runs the whole transfer inside
+start(), like readReg16Bit; a backend that only starts the transfer (interrupt or DMA driven,
+or the simulator in extras/host) lets loop() continue while the bytes are on the wire.
+*/
+
+#ifndef MAX17263Async_h
+#define MAX17263Async_h
+
+#include "MAX17263Bus.h"
+
+struct MAX17263Transaction;
+typedef void (*MAX17263Completion)(MAX17263Transaction &t, void *context);
+
+enum MAX17263TransactionState : byte
+{ transactionIdle, transactionQueued, transactionActive, transactionDone, transactionFailed
+};
+
+struct MAX17263Transaction
+{ byte reg, count;
+  bool write;
+  uint16_t *values; // count words, read into or written from
+  MAX17263Completion callback; // optional
+  void *context;
+  volatile MAX17263TransactionState state = transactionIdle;
+  MAX17263Transaction *next = 0;
+
+  void prepareRead(byte reg, uint16_t *values, byte count, MAX17263Completion callback = 0, void *context = 0);
+  void prepareWrite(byte reg, uint16_t *values, byte count, MAX17263Completion callback = 0, void *context = 0);
+  bool ready() { return state == transactionDone || state == transactionFailed; }
+  bool ok() { return state == transactionDone; }
+};
+
+class MAX17263AsyncBackend
+{
+public:
+  virtual void start(byte address, MAX17263Transaction &t) = 0;
+  virtual bool complete(MAX17263Transaction &t, bool &ok) = 0; // true when the transfer has finished
+};
+
+// Runs the transaction on a blocking MAX17263Bus
+class MAX17263BlockingBackend : public MAX17263AsyncBackend
+{
+public:
+  MAX17263BlockingBackend(MAX17263Bus &bus) : bus(bus) {}
+  void start(byte address, MAX17263Transaction &t);
+  bool complete(MAX17263Transaction &t, bool &ok) { ok = result; return true; }
+
+private:
+  MAX17263Bus &bus;
+  bool result;
+};
+
+class MAX17263AsyncBus
+{
+public:
+  MAX17263AsyncBus(MAX17263AsyncBackend &backend, byte address = 0x36) : backend(backend), address(address) {}
+  bool submit(MAX17263Transaction &t); // false if t is still queued or active
+  void service(); // call from loop()
+  bool idle() { return !head; }
+  uint32_t completed = 0, failed = 0;
+
+private:
+  MAX17263AsyncBackend &backend;
+  byte address;
+  MAX17263Transaction *head = 0, *tail = 0;
+};
+
+#endif
@@ -0,0 +1,51 @@
+/*
+MIT License
+
+Bus layer of the MAX17263 driver. The driver only talks to the chip through a MAX17263Bus,
+so the same driver code runs on Arduino (MAX17263WireBus) and on a Linux host
+(i2c-dev or the simulator in extras/host).
+
+Registers are 16 bit, sent LSB first, the register address auto-increments in a burst
+(AN635 pg 35).
+*/
+
+#ifndef MAX17263Bus_h
+#define MAX17263Bus_h
+
+#include <Arduino.h>
+
+class MAX17263Bus
+{
+public:
+  // Read count consecutive registers starting at reg in one transaction, returns false on a bus error
+  virtual bool readRegs(byte address, byte reg, uint16_t* values, byte count) = 0;
+  // Write count consecutive registers starting at reg in one transaction
+  virtual bool writeRegs(byte address, byte reg, const uint16_t* values, byte count) = 0;
+  // Free a bus that a target holds low after an interrupted transfer: up to 9 SCL clocks until
+  // SDA is released, then a STOP (I2C specification UM10204 3.1.16). False if SDA stays low or not supported.
+  virtual bool clearBus() { return false; }
+};
+
+#ifdef ARDUINO
+#include <Wire.h>
+
+#ifndef MAX17263_WIRE_BUFFER
+#define MAX17263_WIRE_BUFFER 32 // AVR Wire buffer, bursts are split to fit
+#endif
+
+class MAX17263WireBus : public MAX17263Bus
+{
+public:
+  MAX17263WireBus(TwoWire& wire = Wire) : wire(wire) {}
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count);
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count);
+  bool clearBus(); // bit-banged on the SDA and SCL pins of the board, the default Wire only
+
+private:
+  TwoWire& wire;
+};
+
+extern MAX17263WireBus MAX17263Wire; // default bus of the driver
+#endif
+
+#endif
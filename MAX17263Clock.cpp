@@ -0,0 +1,9 @@
+/*
+MIT License
+
+Time source of the MAX17263 driver, see MAX17263Clock.h
+*/
+
+#include "MAX17263Clock.h"
+
+MAX17263SystemClock MAX17263System;
@@ -0,0 +1,36 @@
+/*
+MIT License
+
+Time source of the MAX17263 driver. The driver only reads the time and waits through a
+MAX17263Clock, so tests on a host can run it against a virtual clock that jumps ahead on
+delay(): days of gauge operation then take seconds (extras/host/MAX17263VirtualClock.h).
+The default MAX17263System uses the Arduino millis(), micros() and delay().
+Times are uint32_t and wrap around, compare them as differences.
+*/
+
+#ifndef MAX17263Clock_h
+#define MAX17263Clock_h
+
+#include <Arduino.h>
+
+class MAX17263Clock
+{
+public:
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+  virtual void delay(uint32_t ms) = 0;
+  virtual void delayMicroseconds(uint32_t us) = 0;
+};
+
+class MAX17263SystemClock : public MAX17263Clock
+{
+public:
+  uint32_t millis() { return ::millis(); }
+  uint32_t micros() { return ::micros(); }
+  void delay(uint32_t ms) { ::delay(ms); }
+  void delayMicroseconds(uint32_t us) { ::delayMicroseconds(us); }
+};
+
+extern MAX17263SystemClock MAX17263System; // default clock of the driver
+
+#endif
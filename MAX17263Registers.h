@@ -0,0 +1,120 @@
+/*
+MIT License
+
+Compile-time register descriptors of the MAX17263, UG6597 / UG6595.
+A register is a type with its address, signedness, LSB scale and update period, a field is a
+type with the register, shift and mask. MAX17263::readField<F>() and writeField<F>() use them,
+all masks and shifts are constexpr, so a field access compiles to the same instructions as a
+hand-written mask and shift. Only C++11 is needed.
+
+  uint16_t id = gauge.readField<MAX17263ModelCfgModelID>();
+  gauge.writeField<MAX17263LedCfg2Brightness>(31);
+  uint16_t modelCfg = MAX17263ModelCfgRefresh::bits(1) | MAX17263ModelCfgModelID::bits(6);
+*/
+
+#ifndef MAX17263Registers_h
+#define MAX17263Registers_h
+
+#include <Arduino.h>
+
+// Update period 0: a configuration register, it only changes when written
+template<byte Address, bool Signed, bool PerRSense, uint16_t Period_ms>
+struct MAX17263Register
+{ static constexpr byte address = Address;
+  static constexpr bool isSigned = Signed;
+  static constexpr bool perRSense = PerRSense; // lsb() must be divided by rSense in Ohm, in double before the float result
+  static constexpr uint16_t period_ms = Period_ms;
+};
+
+template<typename Register, byte Shift, byte Width>
+struct MAX17263Field
+{ typedef Register reg;
+  static constexpr byte shift = Shift;
+  static constexpr uint16_t mask = (uint16_t)(((1UL << Width) - 1) << Shift);
+  static constexpr uint16_t bits(uint16_t value) { return (uint16_t)(value << Shift) & mask; } // value in place
+  static constexpr uint16_t get(uint16_t word) { return (word & mask) >> Shift; }
+};
+
+#define MAX17263_REGISTER(name, address, isSigned, scale, perRSense, period_ms) \
+  struct MAX17263Reg##name : MAX17263Register<address, isSigned, perRSense, period_ms> \
+  { static constexpr double lsb() { return scale; } };
+
+#define MAX17263_FIELD(reg, name, shift, width) \
+  typedef MAX17263Field<MAX17263Reg##reg, shift, width> MAX17263##reg##name;
+
+//                name         address signed LSB           /rSense period_ms
+MAX17263_REGISTER(Status,      0x00,   false, 1,            false,  0)
+MAX17263_REGISTER(RepCap,      0x05,   false, 5.0e-3,       true,   5625) // mAh, model output every 5.625s
+MAX17263_REGISTER(RepSOC,      0x06,   false, 1.0 / 256,    false,  5625) // %
+MAX17263_REGISTER(Age,         0x07,   false, 1.0 / 256,    false,  5625) // %
+MAX17263_REGISTER(Temp,        0x08,   true,  1.0 / 256,    false,  1406) // degree Celsius, every 8th conversion
+MAX17263_REGISTER(VCell,       0x09,   false, 7.8125e-5,    false,  175)  // V, every conversion (175.8ms)
+MAX17263_REGISTER(Current,     0x0A,   true,  1.5625e-3,    true,   175)  // mA
+MAX17263_REGISTER(AvgCurrent,  0x0B,   true,  1.5625e-3,    true,   175)  // mA
+MAX17263_REGISTER(FullCapRep,  0x10,   false, 5.0e-3,       true,   5625) // mAh
+MAX17263_REGISTER(TimeToEmpty, 0x11,   false, 5.625 / 3600, false,  5625) // hours
+MAX17263_REGISTER(QRTable00,   0x12,   false, 1,            false,  0)    // QRTable10..30 follow every 0x10
+MAX17263_REGISTER(AvgTA,       0x16,   true,  1.0 / 256,    false,  5625) // degree Celsius
+MAX17263_REGISTER(Cycles,      0x17,   false, 0.16,         false,  5625) // cycles, LSB 16%, bit 2 = 64% (UG6595 Step 3.5)
+MAX17263_REGISTER(DesignCap,   0x18,   false, 5.0e-3,       true,   0)    // mAh
+MAX17263_REGISTER(AvgVCell,    0x19,   false, 7.8125e-5,    false,  175)  // V
+MAX17263_REGISTER(MaxMinTemp,  0x1A,   true,  1,            false,  1406) // degree Celsius per byte
+MAX17263_REGISTER(MaxMinVolt,  0x1B,   false, 0.02,         false,  175)  // V per byte
+MAX17263_REGISTER(MaxMinCurr,  0x1C,   true,  0.4,          true,   175)  // mA per byte
+MAX17263_REGISTER(Config,      0x1D,   false, 1,            false,  0)
+MAX17263_REGISTER(IchgTerm,    0x1E,   true,  1.5625e-3,    true,   0)    // mA
+MAX17263_REGISTER(TimeToFull,  0x20,   false, 5.625 / 3600, false,  5625) // hours
+MAX17263_REGISTER(FullCapNom,  0x23,   false, 5.0e-3,       true,   5625) // mAh
+MAX17263_REGISTER(MiscCfg,     0x2B,   false, 1,            false,  0)
+MAX17263_REGISTER(LedCfg3,     0x37,   false, 1,            false,  0)
+MAX17263_REGISTER(RComp0,      0x38,   false, 1,            false,  5625) // learned, UG6595 page 11
+MAX17263_REGISTER(TempCo,      0x39,   false, 1,            false,  5625) // learned
+MAX17263_REGISTER(VEmpty,      0x3A,   false, 1,            false,  0)
+MAX17263_REGISTER(FStat,       0x3D,   false, 1,            false,  0)
+MAX17263_REGISTER(Timer,       0x3E,   false, 0.1758,       false,  175)  // seconds
+MAX17263_REGISTER(LedCfg1,     0x40,   false, 1,            false,  0)
+MAX17263_REGISTER(LedCfg2,     0x4B,   false, 1,            false,  0)
+MAX17263_REGISTER(QH,          0x4D,   true,  5.0e-3,       true,   175)  // mAh
+MAX17263_REGISTER(Command,     0x60,   false, 1,            false,  0)    // soft-wakeup 0x0090, UG6595 page 7
+MAX17263_REGISTER(ModelLock1,  0x62,   false, 1,            false,  0)    // 0x0059/0x00C4 unlock the model table
+MAX17263_REGISTER(ModelLock2,  0x63,   false, 1,            false,  0)
+MAX17263_REGISTER(CustLED,     0x64,   false, 1,            false,  0)
+MAX17263_REGISTER(ModelTable,  0x80,   false, 1,            false,  0)    // first word of the custom model, UG6595 page 8
+MAX17263_REGISTER(Power,       0xB1,   true,  8.0e-3,       true,   175)  // mW
+MAX17263_REGISTER(AvgPower,    0xB3,   true,  8.0e-3,       true,   175)  // mW
+MAX17263_REGISTER(HibCfg,      0xBA,   false, 1,            false,  0)
+MAX17263_REGISTER(TimerH,      0xBE,   false, 3.2,          false,  0)    // hours, changes every 3.2 hours
+MAX17263_REGISTER(ModelCfg,    0xDB,   false, 1,            false,  0)
+
+//             reg         name          shift width
+MAX17263_FIELD(Status,     POR,          1,    1)  // power on reset, cleared by the host
+MAX17263_FIELD(Status,     BSt,          3,    1)  // battery status, 1 = no battery
+MAX17263_FIELD(Status,     BI,           11,   1)  // battery insertion
+MAX17263_FIELD(Status,     BR,           15,   1)  // battery removal
+MAX17263_FIELD(MaxMinTemp, Min,          0,    8)
+MAX17263_FIELD(MaxMinTemp, Max,          8,    8)
+MAX17263_FIELD(MaxMinVolt, Min,          0,    8)
+MAX17263_FIELD(MaxMinVolt, Max,          8,    8)
+MAX17263_FIELD(MaxMinCurr, Min,          0,    8)
+MAX17263_FIELD(MaxMinCurr, Max,          8,    8)
+MAX17263_FIELD(Cycles,     Save,         2,    1)  // toggles every 64%, save the learned parameters (UG6595 Step 3.5)
+MAX17263_FIELD(Config,     Ber,          0,    1)  // ALRT on battery removal
+MAX17263_FIELD(Config,     Bei,          1,    1)  // ALRT on battery insertion
+MAX17263_FIELD(Config,     Aen,          2,    1)  // ALRT output enable
+MAX17263_FIELD(MiscCfg,    QS,           10,   1)  // Quickstart, cleared when done
+MAX17263_FIELD(MiscCfg,    Verify,       12,   1)  // production test memory check
+MAX17263_FIELD(VEmpty,     VR,           0,    7)  // recovery voltage, 40mV
+MAX17263_FIELD(VEmpty,     VE,           7,    9)  // empty voltage, 10mV
+MAX17263_FIELD(FStat,      DNR,          0,    1)  // data not ready after POR
+MAX17263_FIELD(LedCfg1,    NBARS,        0,    4)  // number of LEDs
+MAX17263_FIELD(LedCfg1,    LChg,         5,    1)  // LEDs on while charging
+MAX17263_FIELD(LedCfg1,    LEDTimer,     13,   3)  // LED on time
+MAX17263_FIELD(LedCfg2,    Brightness,   0,    5)
+MAX17263_FIELD(LedCfg2,    EBlink,       6,    1)  // blink the lowest LED when empty
+MAX17263_FIELD(LedCfg2,    EnAutoLEDCnt, 8,    1)  // count the LEDs at start up
+MAX17263_FIELD(ModelCfg,   ModelID,      4,    4)
+MAX17263_FIELD(ModelCfg,   VChg,         10,   1)  // charge voltage > 4.25V
+MAX17263_FIELD(ModelCfg,   R100,         13,   1)  // 100k NTC
+MAX17263_FIELD(ModelCfg,   Refresh,      15,   1)  // load the model, cleared when done
+
+#endif
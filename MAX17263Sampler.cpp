@@ -0,0 +1,168 @@
+/*
+MIT License
+
+Deadline-based periodic sampler, see MAX17263Sampler.h
+*/
+
+#include "MAX17263Sampler.h"
+
+int8_t MAX17263Sampler::every(uint32_t period_ms, MAX17263Quantity quantity, MAX17263SampleCallback callback, void *context) {
+    int8_t i = add(sampleQuantity, period_ms, context);
+    if (i >= 0) {
+        tasks[i].quantity = quantity;
+        tasks[i].callback.sample = callback;
+    }
+    return i;
+}
+
+int8_t MAX17263Sampler::everySnapshot(uint32_t period_ms, MAX17263SnapshotCallback callback, void *context) {
+    int8_t i = add(sampleSnapshot, period_ms, context);
+    if (i >= 0) {
+        tasks[i].callback.snapshot = callback;
+    }
+    return i;
+}
+
+int8_t MAX17263Sampler::everyStatus(uint32_t period_ms, MAX17263StatusCallback callback, void *context) {
+    int8_t i = add(sampleStatus, period_ms, context);
+    if (i >= 0) {
+        tasks[i].callback.status = callback;
+    }
+    return i;
+}
+
+// Take a free task, due immediately
+int8_t MAX17263Sampler::add(MAX17263SamplerKind kind, uint32_t period_ms, void *context) {
+    for (int8_t i = 0; i < MAX17263_MAX_SAMPLER_TASKS; i++) {
+        if (tasks[i].kind != sampleFree) {
+            continue;
+        }
+        tasks[i].kind = kind;
+        tasks[i].period_ms = period_ms ? period_ms : 1;
+        tasks[i].deadline_ms = clock.millis();
+        tasks[i].context = context;
+        tasks[i].stats = {0, 0, 0, 0xFFFF, 0, 0};
+        return i;
+    }
+    return -1;
+}
+
+void MAX17263Sampler::remove(int8_t task) {
+    if (task >= 0 && task < MAX17263_MAX_SAMPLER_TASKS) {
+        tasks[task].kind = sampleFree;
+    }
+}
+
+void MAX17263Sampler::resetStats() {
+    for (byte i = 0; i < MAX17263_MAX_SAMPLER_TASKS; i++) {
+        tasks[i].stats = {0, 0, 0, 0xFFFF, 0, 0};
+    }
+}
+
+// Run the due tasks, each at most once per call, so a slow task cannot starve the others
+uint32_t MAX17263Sampler::run() {
+    uint32_t next = 0xFFFFFFFF;
+    if (alertPending) {
+        alertPending = false;
+        for (byte i = 0; i < MAX17263_MAX_SAMPLER_TASKS; i++) {
+            if (tasks[i].kind == sampleStatus) {
+                execute(tasks[i]); // the deadlines stay on the grid
+            }
+        }
+    }
+    for (byte i = 0; i < MAX17263_MAX_SAMPLER_TASKS; i++) {
+        MAX17263SamplerTask &task = tasks[i];
+        if (task.kind == sampleFree) {
+            continue;
+        }
+        uint32_t now = clock.millis();
+        int32_t late = (int32_t)(now - task.deadline_ms);
+        if (late >= 0) {
+            uint16_t late_ms = late > 0xFFFF ? 0xFFFF : late;
+            task.stats.runs++;
+            task.stats.sumLate_ms += late_ms;
+            task.stats.minLate_ms = min(task.stats.minLate_ms, late_ms);
+            task.stats.maxLate_ms = max(task.stats.maxLate_ms, late_ms);
+            execute(task);
+            schedule(task, clock.millis()); // after the work, it may have taken longer than the period
+        }
+        int32_t wait = (int32_t)(task.deadline_ms - clock.millis());
+        next = min(next, wait > 0 ? (uint32_t)wait : 0);
+    }
+    return next;
+}
+
+// Read the quantity, snapshot or status of a task and call back
+void MAX17263Sampler::execute(MAX17263SamplerTask &task) {
+    uint32_t errors = gauge.busStats.readErrors + gauge.busStats.writeErrors;
+    switch (task.kind) {
+    case sampleQuantity: {
+        float value = gauge.getQuantity(task.quantity);
+        if (task.callback.sample && !gauge.dataStale) {
+            task.callback.sample(task.quantity, value, task.context);
+        }
+        break;
+    }
+    case sampleSnapshot: {
+        MAX17263Snapshot snapshot;
+        if (gauge.readSnapshot(snapshot) && task.callback.snapshot) {
+            task.callback.snapshot(snapshot, task.context);
+        }
+        break;
+    }
+    default: {
+        // One Status read per check, decoded like batteryPresent(), powerOnResetEvent() and batterySwapEvent()
+        uint16_t status = gauge.getStatus();
+        bool present = !(status & MAX17263StatusBSt::mask), initialized = false;
+        bool due = !initBackoff_ms || (int32_t)(clock.millis() - initRetry_ms) >= 0;
+        if (present && due && (status & MAX17263StatusPOR::mask)) { // Step 0 and 3.2
+            initialized = gauge.initialize();
+            backOff(task, initialized);
+        } else if (present && due && (status & MAX17263StatusBI::mask)) {
+            swaps++;
+            initialized = gauge.reinitializeAfterSwap();
+            backOff(task, initialized);
+        } else if (!present) {
+            gauge.clearBatteryRemoval();
+        }
+        if (task.callback.status) {
+            task.callback.status(present, initialized, task.context);
+        }
+        break;
+    }
+    }
+    task.stats.busErrors += gauge.busStats.readErrors + gauge.busStats.writeErrors != errors;
+}
+
+// Double the wait after every failed initialize(), back to none after a good one
+void MAX17263Sampler::backOff(MAX17263SamplerTask &task, bool initialized) {
+    if (initialized) {
+        initBackoff_ms = 0;
+        return;
+    }
+    initFailures++;
+    initBackoff_ms = initBackoff_ms ? min(2 * initBackoff_ms, maxInitBackoff_ms) : task.period_ms;
+    initRetry_ms = clock.millis() + initBackoff_ms;
+}
+
+// Next deadline, now is the end of the run
+void MAX17263Sampler::schedule(MAX17263SamplerTask &task, uint32_t now) {
+    task.deadline_ms += task.period_ms;
+    if ((int32_t)(now - task.deadline_ms) < 0) {
+        return; // on time
+    }
+    switch (catchUp) {
+    case catchUpAll:
+        break; // the next run() runs the missed deadline
+    case catchUpRestart:
+        task.stats.missed += (now - task.deadline_ms) / task.period_ms + 1;
+        task.deadline_ms = now + task.period_ms;
+        break;
+    default: {
+        uint32_t missed = (now - task.deadline_ms) / task.period_ms + 1;
+        task.stats.missed += missed;
+        task.deadline_ms += missed * task.period_ms;
+        break;
+    }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Deadline-based periodic sampler around the driver, instead of delay() in loop().
+Every task has a fixed period and runs on a grid of deadlines, start + n x period, so the
+duration of the work does not shift the period. run() must be called from loop(), it runs the
+tasks that are due and returns the time until the next deadline, the sketch can do other work
+or sleep in the meantime. Each task has its own rate, e.g. Current every 175ms and Temp every 60s.
+
+A task that is late by more than a period has missed deadlines, catchUp decides what happens:
+  catchUpSkip     drop the missed runs, stay on the grid (default)
+  catchUpAll      run once for every missed deadline, one per run() call, until back on the grid
+  catchUpRestart  start a new grid at the late run, like delay() but without the drift of the work
+The lateness of every run is measured, see MAX17263SamplerStats.
+
+The status task runs initialize() after a POR. When it fails (gauge.fault), the next attempt
+waits a backoff that doubles from the task period up to maxInitBackoff_ms, so a gauge that
+never gets ready does not block the loop for readyTimeout_ms on every status check.
+A battery swap without POR (Status.BI) runs reinitializeAfterSwap() instead, with the same backoff.
+The status period bounds how long a swap goes unnoticed. With gauge.swapAlert the ALRT pin of the
+gauge signals the insertion and removal, an interrupt handler calls alert() and the next run()
+checks the status at once, off the grid of the status task.
+
+  MAX17263Sampler sampler(gauge);
+  sampler.every(175, quantityCurrent, printValue);
+  sampler.every(60000, quantityTemp, printValue);
+  sampler.everySnapshot(5625, logSnapshot);
+  sampler.everyStatus(2000); // initialize() after a POR
+  void onAlert() { sampler.alert(); } // optional, attachInterrupt(digitalPinToInterrupt(ALRT_PIN), onAlert, FALLING)
+  void loop() { sampler.run(); }
+*/
+
+#ifndef MAX17263Sampler_h
+#define MAX17263Sampler_h
+
+#include "MAX17263.h"
+
+#ifndef MAX17263_MAX_SAMPLER_TASKS
+#define MAX17263_MAX_SAMPLER_TASKS 6
+#endif
+
+enum MAX17263CatchUp : byte
+{ catchUpSkip, catchUpAll, catchUpRestart
+};
+
+typedef void (*MAX17263SampleCallback)(MAX17263Quantity quantity, float value, void *context);
+typedef void (*MAX17263SnapshotCallback)(const MAX17263Snapshot &snapshot, void *context);
+typedef void (*MAX17263StatusCallback)(bool batteryPresent, bool initialized, void *context);
+
+struct MAX17263SamplerStats
+{ uint32_t runs, missed; // missed: deadlines without a run, catchUpSkip and catchUpRestart
+  uint32_t busErrors; // runs with a failed read or write
+  uint16_t minLate_ms, maxLate_ms; // lateness of a run after its deadline, jitter = max - min
+  uint32_t sumLate_ms; // mean lateness = sumLate_ms / runs
+};
+
+enum MAX17263SamplerKind : byte
+{ sampleFree, sampleQuantity, sampleSnapshot, sampleStatus
+};
+
+struct MAX17263SamplerTask
+{ MAX17263SamplerKind kind;
+  MAX17263Quantity quantity;
+  uint32_t period_ms, deadline_ms;
+  union
+  { MAX17263SampleCallback sample;
+    MAX17263SnapshotCallback snapshot;
+    MAX17263StatusCallback status;
+  } callback;
+  void *context;
+  MAX17263SamplerStats stats;
+};
+
+class MAX17263Sampler
+{
+public:
+  MAX17263Sampler(MAX17263 &gauge, MAX17263Clock &clock = MAX17263System) : gauge(gauge), clock(clock) {}
+  // Add a task, the first deadline is now. Returns the task number for stats(), -1 when full.
+  int8_t every(uint32_t period_ms, MAX17263Quantity quantity, MAX17263SampleCallback callback, void *context = 0);
+  int8_t everySnapshot(uint32_t period_ms, MAX17263SnapshotCallback callback, void *context = 0);
+  // initialize() after a POR or reinitializeAfterSwap() after a battery swap, initialized: it succeeded
+  int8_t everyStatus(uint32_t period_ms, MAX17263StatusCallback callback = 0, void *context = 0);
+  void remove(int8_t task);
+  uint32_t run(); // call from loop(), runs the due tasks, returns the ms until the next deadline
+  void alert() { alertPending = true; } // from the ALRT interrupt, the next run() checks the status
+  MAX17263SamplerStats &stats(int8_t task) { return tasks[task].stats; }
+  void resetStats();
+  MAX17263CatchUp catchUp = catchUpSkip;
+  uint32_t maxInitBackoff_ms = 60000;
+  uint32_t initFailures = 0; // initialize() or reinitializeAfterSwap() that returned false
+  uint32_t swaps = 0; // reinitializeAfterSwap() calls
+
+private:
+  MAX17263 &gauge;
+  MAX17263Clock &clock; // the clock of the gauge
+  MAX17263SamplerTask tasks[MAX17263_MAX_SAMPLER_TASKS] = {};
+  uint32_t initBackoff_ms = 0, initRetry_ms; // 0: no failed initialize()
+  volatile bool alertPending = false;
+  int8_t add(MAX17263SamplerKind kind, uint32_t period_ms, void *context); // callback set by the caller
+  void execute(MAX17263SamplerTask &task);
+  void backOff(MAX17263SamplerTask &task, bool initialized);
+  void schedule(MAX17263SamplerTask &task, uint32_t now);
+};
+
+#endif
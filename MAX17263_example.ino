@@ -4,11 +4,15 @@ Ignore warning avrdude: warning at C:\Users\Albert\AppData\Local\Arduino15\packa
 byte = uint8_t / 16bit uint16_t
 */
 
-#include "Arduino-MAX17263_Driver.h"
+#include "MAX17263Sampler.h"
 #include <Wire.h>
 #include <Streaming.h>
 
+//#define ALRT_PIN 2 // optional: ALRT of the gauge (open drain, pull-up) on an interrupt pin, for a fast battery swap
+
 MAX17263 max17263;
+MAX17263Sampler sampler(max17263); // fixed deadlines instead of delay(2000), loop() stays free
+float peakCurrent_mA = 0;
 
 void initBatteryParameters()
 { max17263.rSense = 0.002;    
@@ -21,6 +25,9 @@ void initBatteryParameters()
   // 6: for LiFePO4, custom characterization is recommended, instead of an EZ configuration
   max17263.ichgTerm = 0x0640; // 250mA on 10mΩ, leave default 
   max17263.vEmpty = 3.3; // leave default 
+#ifdef ALRT_PIN
+  max17263.swapAlert = true; // ALRT on battery insertion and removal
+#endif
 }
 
 void printFuelGaugeResults()
@@ -32,7 +39,31 @@ void printFuelGaugeResults()
   Serial << "\nTTE Time to empty: " << _FLOAT(max17263.getTimeToEmpty(), 2) << " hours";
   Serial << "\nTemp: " << _FLOAT(max17263.getTemp(), 1) << " degree Celcius";
   Serial << "\nAvgVCell: " << _BIN(max17263.getAvgVCell());
+  Serial << "\nPeak current: " << _FLOAT(peakCurrent_mA, 2) << " mA";
   Serial << endl;
+  peakCurrent_mA = 0;
+}
+
+void trackPeakCurrent(MAX17263Quantity quantity, float value, void *context)
+{ if(fabs(value) > fabs(peakCurrent_mA)) peakCurrent_mA = value; // every 175ms, each ADC conversion
+}
+
+void printTemp(MAX17263Quantity quantity, float value, void *context)
+{ Serial << "\nTemp: " << _FLOAT(value, 1) << " degree Celcius";
+}
+
+void checkStatus(bool batteryPresent, bool initialized, void *context) // Step 0 and 3.2 periodically check reset and than initialize
+{ // without battery, status reading is 1111111111111111, so wait for Bst flag 1111111111110111 
+  //if(initialized && fuelGaugeTest) max17263.productionTest();
+  // Step 3.6: if(initialized && historySaved) restoreHistory() Restoring Learned Parameters
+  // initialized is also set after a battery swap, reinitializeAfterSwap(), the SOC is of the new battery
+  if(max17263.fault) Serial << F("\nGauge fault ") << max17263.fault << F(", initialize() is retried with a backoff");
+  else if(batteryPresent) printFuelGaugeResults(); // Step 3.3 read the Fuel-Gauge Results 
+  // Step 3.5 Save Learned Parameters every time bit 2 of the Cycles register toggles    
+}
+
+void onAlert() // battery inserted or removed, the next sampler.run() checks the status
+{ sampler.alert();
 }
 
 void setup() 
@@ -41,17 +72,15 @@ void setup()
   delay(500); // just a small delay before first communications to MAX chip
   while(!Serial); // wait until serial port opens for native USB devices
   initBatteryParameters();
+  sampler.everyStatus(2000, checkStatus);
+  sampler.every(175, quantityCurrent, trackPeakCurrent);
+  sampler.every(60000, quantityTemp, printTemp);
+#ifdef ALRT_PIN
+  pinMode(ALRT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ALRT_PIN), onAlert, FALLING);
+#endif
 }
 
 void loop() 
-{ if(max17263.batteryPresent()) // without battery, status reading is 1111111111111111, so wait for Bst flag 1111111111110111 
-  { if(max17263.powerOnResetEvent()) 
-    { max17263.initialize(); // Step 0 and 3.2 periodically check reset and than initialize  
-      //if(fuelGaugeTest) max17263.productionTest();
-      // Step 3.6: if(historySaved) restoreHistory() Restoring Learned Parameters
-    }  
-    printFuelGaugeResults(); // Step 3.3 read the Fuel-Gauge Results 
-    // Step 3.5 Save Learned Parameters every time bit 2 of the Cycles register toggles    
-  }
-  delay(2000);
+{ sampler.run(); // other work can be done here, run() returns the time until the next deadline
 }
@@ -0,0 +1,38 @@
+/*
+MIT License
+
+Host implementation of the Arduino time functions, based on std::chrono::steady_clock or on the
+clock of setArduinoClock(). Like on the MCU, millis() and micros() wrap around.
+*/
+
+#include "Arduino.h"
+#include "MAX17263Clock.h" // repository root, compile with -I../..
+#include <chrono>
+#include <thread>
+
+static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+static MAX17263Clock* arduinoClock = 0;
+
+void setArduinoClock(MAX17263Clock* clock)
+{ arduinoClock = clock;
+}
+
+uint32_t millis()
+{ if(arduinoClock) return arduinoClock->millis();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t micros()
+{ if(arduinoClock) return arduinoClock->micros();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void delay(uint32_t ms)
+{ if(arduinoClock) return arduinoClock->delay(ms);
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{ if(arduinoClock) return arduinoClock->delayMicroseconds(us);
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
@@ -0,0 +1,34 @@
+/*
+MIT License
+
+Minimal Arduino.h for compiling the driver (MAX17263.cpp) on a Linux host.
+Only what the driver uses: byte, millis(), micros(), delay(), delayMicroseconds(), min() and the PROGMEM
+functions, flash is ordinary memory on the host. setArduinoClock() puts the time functions on a
+MAX17263Clock, e.g. a MAX17263VirtualClock for the sketch, which calls them directly.
+*/
+
+#ifndef MAX17263_HOST_ARDUINO_h
+#define MAX17263_HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+class MAX17263Clock;
+void setArduinoClock(MAX17263Clock* clock); // 0: std::chrono::steady_clock, the default
+
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+
+using std::min;
+using std::max;
+
+#endif
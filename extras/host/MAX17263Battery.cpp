@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Battery and load scenario engine, see MAX17263Battery.h
+*/
+
+#include "MAX17263Battery.h"
+
+// OCV of a lithium cobalt-oxide cell, every 10% SOC
+static const float ocvTable[11] = {3.00, 3.45, 3.58, 3.65, 3.70, 3.76, 3.83, 3.91, 3.99, 4.08, 4.19};
+
+float MAX17263Cell::ocv() const
+{ float x = soc * 10;
+  if(x <= 0) return ocvTable[0];
+  if(x >= 10) return ocvTable[10];
+  int i = x;
+  return ocvTable[i] + (ocvTable[i + 1] - ocvTable[i]) * (x - i);
+}
+
+// VEmpty.VE, 10mV LSB
+float MAX17263Scenario::vEmpty()
+{ return (sim.regs[0x3A] >> 7) * 0.01;
+}
+
+// IChgTerm, 1.5625uV / rSense
+float MAX17263Scenario::ichgTerm_mA()
+{ return sim.regs[0x1E] * 1.5625e-3 / sim.rSense;
+}
+
+// Current of the step now, the constant voltage phase of a charge is limited by the cell
+float MAX17263Scenario::current(const MAX17263LoadStep& s)
+{ switch(s.kind)
+  { case loadConstant: return s.current_mA;
+    case loadPulsed: return s.period_ms && stepTime_ms % s.period_ms < s.on_ms ? s.current_mA : s.low_mA;
+    case loadCharge:
+    { if(!constantVoltage) return s.current_mA;
+      float i = (s.vCharge - cell.ocv()) / cell.r_ohm * 1000;
+      return i < 0 ? 0 : i > s.current_mA ? s.current_mA : i;
+    }
+    default: return 0;
+  }
+}
+
+void MAX17263Scenario::nextStep()
+{ stepTime_ms = 0;
+  constantVoltage = false;
+  if(++step < steps.size()) return;
+  step = 0;
+  cycles++;
+}
+
+void MAX17263Scenario::advance(uint32_t ms)
+{ if(steps.empty()) return;
+  float i = 0;
+  while(ms)
+  { const MAX17263LoadStep& s = steps[step];
+    uint32_t dt = ms < resolution_ms ? ms : resolution_ms;
+    if(s.kind == loadPulsed && s.period_ms) // up to the next edge of the pulse
+    { uint32_t phase = stepTime_ms % s.period_ms;
+      uint32_t edge = phase < s.on_ms ? s.on_ms - phase : s.period_ms - phase;
+      if(edge < dt) dt = edge;
+    }
+    if(s.duration_ms && s.duration_ms - stepTime_ms < dt) dt = s.duration_ms - stepTime_ms;
+    i = current(s);
+    cell.soc += i * dt / 3600000 / cell.capacity_mAh;
+    if(cell.soc < 0) cell.soc = 0;
+    if(cell.soc > 1) cell.soc = 1;
+    if(i < 0) throughput_mAh -= i * dt / 3600000;
+    stepTime_ms += dt;
+    ms -= dt;
+
+    // end of the step
+    float v = cell.terminal_V(i);
+    if(s.kind == loadCharge && !constantVoltage && v >= s.vCharge) constantVoltage = true;
+    if((s.kind == loadConstant || s.kind == loadPulsed) && (v < vEmpty() || cell.soc == 0))
+    { emptyStops++;
+      nextStep();
+    }
+    else if(s.kind == loadCharge && constantVoltage && (i < ichgTerm_mA() || cell.soc == 1))
+    { chargeTerminations++;
+      nextStep();
+    }
+    else if(s.kind == loadRest ? stepTime_ms >= s.duration_ms : s.duration_ms && stepTime_ms >= s.duration_ms)
+    { timeLimits += s.kind != loadRest;
+      nextStep();
+    }
+  }
+  sim.current_mA = i;
+  sim.battery_V = cell.terminal_V(i);
+  sim.soc_percent = cell.soc * 100;
+}
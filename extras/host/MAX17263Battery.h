@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Battery and load scenario engine for the simulated gauge. MAX17263Cell is a cell with an OCV
+curve, a capacity and an internal resistance; MAX17263Scenario runs a list of load steps on it
+and drives MAX17263Sim (battery voltage, current and SOC), while the driver reads the gauge
+through the bus as usual. With a MAX17263VirtualClock the time advances as fast as the CPU allows.
+
+Load steps, currents in mA with the gauge sign (negative = discharge):
+  loadConstant  constant current until the terminal voltage drops below VEmpty
+  loadPulsed    current_mA for on_ms, low_mA for the rest of period_ms, until below VEmpty
+  loadCharge    CC-CV: current_mA until vCharge, then constant voltage until the current
+                drops below IchgTerm, the charge termination
+  loadRest      no current for duration_ms
+VEmpty and IchgTerm are read from the simulated chip registers, so the scenario ends its
+discharge and charge where the configuration the driver wrote says. duration_ms also limits the
+other steps, 0 = no limit. After the last step the scenario starts again, one pass is a cycle.
+The simulator counts the current it has at each bus access, short pulses between the reads
+of the driver are missed by its QH and Cycles, the cell itself counts them exactly.
+*/
+
+#ifndef MAX17263Battery_h
+#define MAX17263Battery_h
+
+#include "MAX17263Sim.h"
+#include <vector>
+
+struct MAX17263Cell
+{ float capacity_mAh = 3000;
+  float r_ohm = 0.08; // internal resistance
+  float soc = 0.5; // 0..1
+  float ocv() const; // open circuit voltage of a lithium cobalt-oxide cell at soc
+  float terminal_V(float current_mA) const { return ocv() + current_mA / 1000 * r_ohm; }
+};
+
+enum MAX17263LoadKind : byte
+{ loadRest, loadConstant, loadPulsed, loadCharge
+};
+
+struct MAX17263LoadStep
+{ MAX17263LoadKind kind;
+  float current_mA; // discharge negative, charge positive
+  float low_mA = 0; // loadPulsed: between the pulses
+  uint32_t on_ms = 0, period_ms = 0; // loadPulsed
+  float vCharge = 4.2; // loadCharge
+  uint32_t duration_ms = 0; // loadRest, limit of the other steps, 0 = none
+};
+
+class MAX17263Scenario
+{
+public:
+  MAX17263Scenario(MAX17263Sim& sim) : sim(sim) {}
+  void advance(uint32_t ms); // integrate the cell and update the simulator, in steps of resolution_ms
+  float vEmpty(); // V, from the VEmpty register
+  float ichgTerm_mA(); // from the IchgTerm register and the sense resistor
+
+  MAX17263Cell cell;
+  std::vector<MAX17263LoadStep> steps;
+  uint32_t resolution_ms = 1000; // integration step, pulses are resolved exactly
+  uint32_t cycles = 0; // passes through all steps
+  uint32_t emptyStops = 0, chargeTerminations = 0, timeLimits = 0; // how the steps ended
+  double throughput_mAh = 0; // discharged charge
+
+private:
+  MAX17263Sim& sim;
+  size_t step = 0;
+  uint32_t stepTime_ms = 0;
+  bool constantVoltage = false;
+  float current(const MAX17263LoadStep& s);
+  void nextStep();
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*
+MIT License
+
+SSE4.1 / AVX2 / AVX-512 kernels with runtime dispatch and a scalar fallback.
+Build with GCC or Clang, no -march flag is needed: the wide kernels use target attributes
+and are only called after __builtin_cpu_supports() confirmed the instruction set.
+Do not build with -ffast-math, the kernels rely on plain IEEE float multiplication.
+*/
+
+#include "MAX17263Convert.h"
+#include "MAX17263Registers.h" // repository root, compile with -I. -I../..
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MAX17263_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+MAX17263Scales max17263Scales(float rSense)
+{ MAX17263Scales s;
+  s.current_mA = MAX17263RegCurrent::lsb() / rSense; // same expressions as MAX17263::calcMultipliers()
+  s.capacity_mAh = MAX17263RegRepCap::lsb() / rSense;
+  s.vcell_V = MAX17263RegVCell::lsb(); // UG6595 page 4
+  s.soc_percent = MAX17263RegRepSOC::lsb();
+  s.temp_C = 1.0/256.0; // getTemp() divides by 256.0, which is exact for every int16_t
+  return s;
+}
+
+// Scalar kernels, also used for the tail of the vector kernels
+
+static void convertSignedScalar(const uint16_t* raw, float* out, size_t n, float lsb)
+{ for(size_t i=0; i<n; i++) out[i] = (float)(int16_t)raw[i] * lsb;
+}
+
+static void convertUnsignedScalar(const uint16_t* raw, float* out, size_t n, float lsb)
+{ for(size_t i=0; i<n; i++) out[i] = (float)raw[i] * lsb;
+}
+
+#ifdef MAX17263_CONVERT_X86
+
+// SSE4.1: 8 words per iteration, pmovsxwd/pmovzxwd + cvtdq2ps + mulps
+
+__attribute__((target("sse4.1")))
+static void convertSignedSSE41(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m128 scale = _mm_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+8 <= n; i+=8)
+  { __m128i w = _mm_loadu_si128((const __m128i*)(raw+i));
+    __m128 lo = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(w));
+    __m128 hi = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(w, 8)));
+    _mm_storeu_ps(out+i,   _mm_mul_ps(lo, scale));
+    _mm_storeu_ps(out+i+4, _mm_mul_ps(hi, scale));
+  }
+  convertSignedScalar(raw+i, out+i, n-i, lsb);
+}
+
+__attribute__((target("sse4.1")))
+static void convertUnsignedSSE41(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m128 scale = _mm_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+8 <= n; i+=8)
+  { __m128i w = _mm_loadu_si128((const __m128i*)(raw+i));
+    __m128 lo = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(w));
+    __m128 hi = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(w, 8)));
+    _mm_storeu_ps(out+i,   _mm_mul_ps(lo, scale));
+    _mm_storeu_ps(out+i+4, _mm_mul_ps(hi, scale));
+  }
+  convertUnsignedScalar(raw+i, out+i, n-i, lsb);
+}
+
+// AVX2: 16 words per iteration
+
+__attribute__((target("avx2")))
+static void convertSignedAVX2(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m256 scale = _mm256_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+16 <= n; i+=16)
+  { __m128i w0 = _mm_loadu_si128((const __m128i*)(raw+i));
+    __m128i w1 = _mm_loadu_si128((const __m128i*)(raw+i+8));
+    _mm256_storeu_ps(out+i,   _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(w0)), scale));
+    _mm256_storeu_ps(out+i+8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(w1)), scale));
+  }
+  convertSignedSSE41(raw+i, out+i, n-i, lsb);
+}
+
+__attribute__((target("avx2")))
+static void convertUnsignedAVX2(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m256 scale = _mm256_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+16 <= n; i+=16)
+  { __m128i w0 = _mm_loadu_si128((const __m128i*)(raw+i));
+    __m128i w1 = _mm_loadu_si128((const __m128i*)(raw+i+8));
+    _mm256_storeu_ps(out+i,   _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(w0)), scale));
+    _mm256_storeu_ps(out+i+8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(w1)), scale));
+  }
+  convertUnsignedSSE41(raw+i, out+i, n-i, lsb);
+}
+
+// AVX-512F: 32 words per iteration
+// The zero-masked forms with a full mask compile to the same instructions as the plain ones, whose
+// GCC 12 headers start from _mm512_undefined_* and trip -Wmaybe-uninitialized under -Wall.
+
+__attribute__((target("avx512f")))
+static inline __m512 widenSigned512(__m256i w)
+{ return _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepi16_epi32(0xFFFF, w));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 widenUnsigned512(__m256i w)
+{ return _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu16_epi32(0xFFFF, w));
+}
+
+__attribute__((target("avx512f")))
+static void convertSignedAVX512(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m512 scale = _mm512_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+32 <= n; i+=32)
+  { __m256i w0 = _mm256_loadu_si256((const __m256i*)(raw+i));
+    __m256i w1 = _mm256_loadu_si256((const __m256i*)(raw+i+16));
+    _mm512_storeu_ps(out+i,    _mm512_mul_ps(widenSigned512(w0), scale));
+    _mm512_storeu_ps(out+i+16, _mm512_mul_ps(widenSigned512(w1), scale));
+  }
+  convertSignedAVX2(raw+i, out+i, n-i, lsb);
+}
+
+__attribute__((target("avx512f")))
+static void convertUnsignedAVX512(const uint16_t* raw, float* out, size_t n, float lsb)
+{ const __m512 scale = _mm512_set1_ps(lsb);
+  size_t i = 0;
+  for(; i+32 <= n; i+=32)
+  { __m256i w0 = _mm256_loadu_si256((const __m256i*)(raw+i));
+    __m256i w1 = _mm256_loadu_si256((const __m256i*)(raw+i+16));
+    _mm512_storeu_ps(out+i,    _mm512_mul_ps(widenUnsigned512(w0), scale));
+    _mm512_storeu_ps(out+i+16, _mm512_mul_ps(widenUnsigned512(w1), scale));
+  }
+  convertUnsignedAVX2(raw+i, out+i, n-i, lsb);
+}
+
+#endif // MAX17263_CONVERT_X86
+
+bool max17263ConvertSupported(MAX17263ConvertISA isa)
+{ switch(isa)
+  { case convertScalar: return true;
+    case convertBest: return true;
+#ifdef MAX17263_CONVERT_X86
+    case convertSSE41: return __builtin_cpu_supports("sse4.1");
+    case convertAVX2: return __builtin_cpu_supports("avx2");
+    case convertAVX512: return __builtin_cpu_supports("avx512f");
+#endif
+    default: return false;
+  }
+}
+
+MAX17263ConvertKernels max17263ConvertKernels(MAX17263ConvertISA isa)
+{ MAX17263ConvertKernels scalar = {"scalar", convertSignedScalar, convertUnsignedScalar};
+#ifdef MAX17263_CONVERT_X86
+  MAX17263ConvertKernels sse41 = {"sse4.1", convertSignedSSE41, convertUnsignedSSE41};
+  MAX17263ConvertKernels avx2 = {"avx2", convertSignedAVX2, convertUnsignedAVX2};
+  MAX17263ConvertKernels avx512 = {"avx512", convertSignedAVX512, convertUnsignedAVX512};
+  if(isa == convertBest)
+  { if(max17263ConvertSupported(convertAVX512)) return avx512;
+    if(max17263ConvertSupported(convertAVX2)) return avx2;
+    if(max17263ConvertSupported(convertSSE41)) return sse41;
+    return scalar;
+  }
+  if(!max17263ConvertSupported(isa)) return scalar;
+  if(isa == convertSSE41) return sse41;
+  if(isa == convertAVX2) return avx2;
+  if(isa == convertAVX512) return avx512;
+#endif
+  return scalar;
+}
+
+static const MAX17263ConvertKernels& dispatched()
+{ static const MAX17263ConvertKernels k = max17263ConvertKernels(convertBest); // resolved once
+  return k;
+}
+
+void max17263ConvertCurrent(const uint16_t* raw, float* out_mA, size_t n, const MAX17263Scales& s)
+{ dispatched().convertSigned(raw, out_mA, n, s.current_mA);
+}
+
+void max17263ConvertVCell(const uint16_t* raw, float* out_V, size_t n, const MAX17263Scales& s)
+{ dispatched().convertUnsigned(raw, out_V, n, s.vcell_V);
+}
+
+void max17263ConvertCapacity(const uint16_t* raw, float* out_mAh, size_t n, const MAX17263Scales& s)
+{ dispatched().convertUnsigned(raw, out_mAh, n, s.capacity_mAh);
+}
+
+void max17263ConvertSOC(const uint16_t* raw, float* out_percent, size_t n, const MAX17263Scales& s)
+{ dispatched().convertUnsigned(raw, out_percent, n, s.soc_percent);
+}
+
+void max17263ConvertTemp(const uint16_t* raw, float* out_C, size_t n, const MAX17263Scales& s)
+{ dispatched().convertSigned(raw, out_C, n, s.temp_C);
+}
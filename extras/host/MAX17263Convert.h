@@ -0,0 +1,52 @@
+/*
+MIT License
+
+Host-side batch conversion of raw MAX17263 register words into engineering units.
+Not part of the Arduino build (the IDE does not compile the extras folder).
+
+Every kernel computes out[i] = (float)raw[i] * lsb with one IEEE single precision
+multiply per element, exactly like the scalar getters in MAX17263.cpp, so all
+kernels give bit-identical results on any x86 CPU.
+*/
+
+#ifndef MAX17263Convert_h
+#define MAX17263Convert_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LSB sizes as float, computed with the same expressions as MAX17263::calcMultipliers()
+struct MAX17263Scales
+{ float current_mA;   // Current, AvgCurrent (signed)
+  float capacity_mAh; // RepCap, DesignCap (unsigned)
+  float vcell_V;      // VCell, AvgVCell (unsigned)
+  float soc_percent;  // RepSOC (unsigned), 1/256 %
+  float temp_C;       // Temp (signed), 1/256 degree Celsius
+};
+
+MAX17263Scales max17263Scales(float rSense);
+
+// raw words are treated as int16_t (Current, Temp) or uint16_t (VCell, RepCap, RepSOC)
+typedef void (*MAX17263ConvertFn)(const uint16_t* raw, float* out, size_t n, float lsb);
+
+struct MAX17263ConvertKernels
+{ const char* name; // "scalar", "sse4.1", "avx2" or "avx512"
+  MAX17263ConvertFn convertSigned;
+  MAX17263ConvertFn convertUnsigned;
+};
+
+enum MAX17263ConvertISA { convertScalar, convertSSE41, convertAVX2, convertAVX512, convertBest };
+
+// Returns the kernels for isa, or the scalar kernels if the CPU does not support it.
+// convertBest selects the widest instruction set the CPU supports (runtime dispatch).
+MAX17263ConvertKernels max17263ConvertKernels(MAX17263ConvertISA isa = convertBest);
+bool max17263ConvertSupported(MAX17263ConvertISA isa);
+
+// Convenience wrappers using the runtime dispatched kernels
+void max17263ConvertCurrent(const uint16_t* raw, float* out_mA, size_t n, const MAX17263Scales& s);
+void max17263ConvertVCell(const uint16_t* raw, float* out_V, size_t n, const MAX17263Scales& s);
+void max17263ConvertCapacity(const uint16_t* raw, float* out_mAh, size_t n, const MAX17263Scales& s);
+void max17263ConvertSOC(const uint16_t* raw, float* out_percent, size_t n, const MAX17263Scales& s);
+void max17263ConvertTemp(const uint16_t* raw, float* out_C, size_t n, const MAX17263Scales& s);
+
+#endif
@@ -0,0 +1,176 @@
+/*
+MIT License
+
+C++20 coroutine API, see MAX17263Coro.h
+*/
+
+#include "MAX17263Coro.h"
+#include <thread>
+#include <chrono>
+
+static void resumeTransfer(MAX17263Transaction& t, void* context)
+{ MAX17263EventLoop::TransferAwaiter* a = (MAX17263EventLoop::TransferAwaiter*)context;
+  a->loop->schedule(a->h);
+}
+
+void MAX17263EventLoop::TransferAwaiter::await_suspend(std::coroutine_handle<> c)
+{ h = c;
+  t->callback = resumeTransfer;
+  t->context = this;
+  bus->submit(*t);
+}
+
+void MAX17263EventLoop::SleepAwaiter::await_suspend(std::coroutine_handle<> c)
+{ loop->timers.push({millis() + ms, c});
+}
+
+void MAX17263EventLoop::run()
+{ for(;;)
+  { bool busy = false;
+    for(MAX17263AsyncBus* bus : buses)
+    { bus->service(); // runs the completion callbacks, they schedule the waiting coroutines
+      busy |= !bus->idle();
+    }
+    while(!timers.empty() && (int32_t)(millis() - timers.top().due_ms) >= 0)
+    { ready.push_back(timers.top().h);
+      timers.pop();
+    }
+    while(!ready.empty())
+    { std::coroutine_handle<> h = ready.front();
+      ready.pop_front();
+      h.resume();
+    }
+    bool done = true;
+    for(MAX17263Task<bool>* t : tasks) done &= t->done();
+    if(done) return;
+    if(busy) std::this_thread::sleep_for(std::chrono::microseconds(20)); // transfers on the wire
+    else if(!timers.empty())
+    { int32_t wait_ms = timers.top().due_ms - millis();
+      if(wait_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+    }
+  }
+}
+
+MAX17263Task<bool> MAX17263CoroGauge::read(byte reg, uint16_t* values, byte count)
+{ MAX17263Transaction t;
+  t.prepareRead(reg, values, count);
+  co_return co_await loop.transfer(bus, t);
+}
+
+MAX17263Task<bool> MAX17263CoroGauge::write(byte reg, uint16_t value)
+{ MAX17263Transaction t;
+  t.prepareWrite(reg, &value, 1);
+  co_return co_await loop.transfer(bus, t);
+}
+
+// Poll every 10ms like the driver, but yield in between, sets fault like MAX17263::waitForClear()
+MAX17263Task<bool> MAX17263CoroGauge::waitUntilClear(byte reg, uint16_t mask, MAX17263Fault timeoutFault)
+{ uint32_t start = millis();
+  uint16_t value;
+  do
+  { if(!co_await read(reg, &value))
+    { fault = faultBus;
+      co_return false;
+    }
+    if(!(value & mask)) co_return true;
+    co_await loop.sleep(10);
+  } while(millis() - start < readyTimeout_ms);
+  fault = timeoutFault;
+  co_return false;
+}
+
+// MAX17263::setEZconfig(): only the registers that differ from the image are written, the ModelCfg
+// refresh only when a model register differs, one verification read pass at the end
+MAX17263Task<bool> MAX17263CoroGauge::writeConfig(const MAX17263ConfigEntry* image, byte size, MAX17263& driver)
+{ uint16_t current[MAX17263_CONFIG_SIZE];
+  bool modelDiffers = false;
+  uint32_t dirty = 0;
+  for(byte i = 0; i < size; i++)
+  { if(!co_await read(image[i].reg, &current[i])) { fault = faultBus; co_return false; }
+    uint16_t mask = image[i].mask & ~driver.configSelfClearing(image[i].reg);
+    if((current[i] & mask) != (image[i].value & mask))
+    { dirty |= 1UL << i;
+      modelDiffers |= driver.configNeedsRefresh(image[i].reg);
+    }
+  }
+  modelRefreshSkipped = !modelDiffers;
+  if(modelDiffers) dirty |= 1UL << (size - 1); // ModelCfg with the Refresh bit, last in the image
+  for(byte i = 0; i < size; i++)
+    if((dirty & (1UL << i)) && !co_await write(image[i].reg, (current[i] & ~image[i].mask) | (image[i].value & image[i].mask)))
+    { fault = faultBus;
+      co_return false;
+    }
+  if(modelDiffers && !co_await waitUntilClear(MAX17263RegModelCfg::address, MAX17263ModelCfgRefresh::mask, faultRefresh))
+    co_return false;
+  for(byte i = 0; i < size; i++)
+  { uint16_t value, mask = image[i].mask & ~driver.configSelfClearing(image[i].reg);
+    if(!co_await read(image[i].reg, &value)) { fault = faultBus; co_return false; }
+    if((value & mask) != (image[i].value & mask)) { fault = faultConfig; co_return false; }
+  }
+  co_return true;
+}
+
+// The sequence of MAX17263::initialize() without the custom model: HibCfg is restored on every
+// path after the hibernate exit, POR, BI and BR are cleared only when the configuration is in place
+MAX17263Task<bool> MAX17263CoroGauge::initialize()
+{ const byte regHibCfg = MAX17263RegHibCfg::address, regCommand = MAX17263RegCommand::address,
+             regStatus = MAX17263RegStatus::address;
+  MAX17263 driver; // the configuration image and its rules come from the driver
+  driver.rSense = rSense;
+  driver.designCap_mAh = designCap_mAh;
+  driver.ichgTerm = ichgTerm;
+  driver.vEmpty = vEmpty;
+  driver.modelID = modelID;
+  driver.r100 = r100;
+  driver.vChg = vChg;
+  driver.swapAlert = swapAlert;
+  MAX17263ConfigEntry image[MAX17263_CONFIG_SIZE];
+  byte size = driver.configurationImage(image);
+  uint16_t hibCfg, status;
+  fault = faultNone;
+  if(!co_await read(regHibCfg, &hibCfg)) // store before exit hibernate clears it, without it the gauge is not touched
+  { fault = faultBus;
+    co_return false;
+  }
+  bool ok = co_await write(regCommand, 0x0090) && co_await write(regHibCfg, 0x0000) && co_await write(regCommand, 0x0000);
+  if(!ok) fault = faultBus;
+  ok = ok && co_await waitUntilClear(MAX17263RegFStat::address, MAX17263FStatDNR::mask, faultDataNotReady)
+          && co_await writeConfig(image, size, driver);
+  if(ok && !(co_await read(regStatus, &status) && co_await write(regStatus, status & ~(MAX17263StatusPOR::mask |
+                                                               MAX17263StatusBI::mask | MAX17263StatusBR::mask))))
+  { fault = faultBus; // POR stays set, the next status check runs initialize() again
+    ok = false;
+  }
+  co_await write(regHibCfg, hibCfg); // also after a fault, like the driver
+  co_return ok;
+}
+
+// Same as MAX17263::readSnapshot(), without counting TimerH
+MAX17263Task<bool> MAX17263CoroGauge::readSnapshot(MAX17263Snapshot& snapshot)
+{ uint16_t burst[6]; // RepCap..Current
+  snapshot.time_ms = millis();
+  if(!co_await read(MAX17263RegRepCap::address, burst, 6) || !co_await read(MAX17263RegTimer::address, &snapshot.timer)
+     || !co_await read(MAX17263RegTimerH::address, &snapshot.timerH))
+    co_return false;
+  snapshot.repCap = burst[0];
+  snapshot.repSOC = burst[1];
+  snapshot.age = burst[2];
+  snapshot.temp = burst[3];
+  snapshot.vCell = burst[4];
+  snapshot.current = burst[5];
+  co_return co_await read(MAX17263RegTimeToEmpty::address, &snapshot.timeToEmpty)
+            && co_await read(MAX17263RegAvgVCell::address, &snapshot.avgVCell);
+}
+
+// Same as MAX17263::saveLearnedParams(), params is only written when every read succeeded
+MAX17263Task<bool> MAX17263CoroGauge::saveLearnedParams(MAX17263LearnedParams& params)
+{ uint16_t rComp0TempCo[2];
+  MAX17263LearnedParams p;
+  bool ok = co_await read(MAX17263RegRComp0::address, rComp0TempCo, 2) && co_await read(MAX17263RegFullCapRep::address, &p.fullCapRep)
+            && co_await read(MAX17263RegCycles::address, &p.cycles) && co_await read(MAX17263RegFullCapNom::address, &p.fullCapNom);
+  if(!ok) co_return false;
+  p.rComp0 = rComp0TempCo[0];
+  p.tempCo = rComp0TempCo[1];
+  params = p;
+  co_return true;
+}
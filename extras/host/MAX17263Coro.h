@@ -0,0 +1,133 @@
+/*
+MIT License
+
+C++20 coroutine API for driving many gauges from one host thread.
+initialize(), readSnapshot() and saveLearnedParams() are coroutines on a MAX17263AsyncBus;
+every bus transfer and every wait for FStat.DNR or the ModelCfg refresh suspends the coroutine,
+so MAX17263EventLoop can run the other gauges meanwhile instead of sleeping.
+*/
+
+#ifndef MAX17263Coro_h
+#define MAX17263Coro_h
+
+#include "MAX17263.h" // repository root, compile with -I../..
+#include "MAX17263Async.h"
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Lazily started coroutine returning T, awaitable from another coroutine
+template<typename T>
+class MAX17263Task
+{
+public:
+  struct promise_type
+  { T value{};
+    std::coroutine_handle<> continuation;
+
+    MAX17263Task get_return_object() { return MAX17263Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    struct FinalAwaiter
+    { bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+      { std::coroutine_handle<> c = h.promise().continuation;
+        return c ? c : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_value(T v) { value = std::move(v); }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  explicit MAX17263Task(std::coroutine_handle<promise_type> h) : h(h) {}
+  MAX17263Task(MAX17263Task&& other) noexcept : h(std::exchange(other.h, {})) {}
+  MAX17263Task(const MAX17263Task&) = delete;
+  ~MAX17263Task() { if(h) h.destroy(); }
+
+  bool await_ready() { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) { h.promise().continuation = c; return h; }
+  T await_resume() { return std::move(h.promise().value); }
+
+  bool done() const { return !h || h.done(); }
+  T result() const { return h.promise().value; }
+  std::coroutine_handle<promise_type> handle() const { return h; }
+
+private:
+  std::coroutine_handle<promise_type> h;
+};
+
+class MAX17263EventLoop
+{
+public:
+  void addBus(MAX17263AsyncBus& bus) { buses.push_back(&bus); }
+  void spawn(MAX17263Task<bool>& task) { tasks.push_back(&task); schedule(task.handle()); } // task must outlive run()
+  void schedule(std::coroutine_handle<> h) { ready.push_back(h); }
+  void run(); // until all spawned tasks are done
+
+  struct TransferAwaiter
+  { MAX17263EventLoop* loop;
+    MAX17263AsyncBus* bus;
+    MAX17263Transaction* t;
+    std::coroutine_handle<> h;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> c);
+    bool await_resume() { return t->ok(); }
+  };
+  TransferAwaiter transfer(MAX17263AsyncBus& bus, MAX17263Transaction& t) { return {this, &bus, &t, {}}; }
+
+  struct SleepAwaiter
+  { MAX17263EventLoop* loop;
+    uint32_t ms;
+    bool await_ready() { return ms == 0; }
+    void await_suspend(std::coroutine_handle<> c);
+    void await_resume() {}
+  };
+  SleepAwaiter sleep(uint32_t ms) { return {this, ms}; }
+
+private:
+  struct Timer
+  { uint32_t due_ms;
+    std::coroutine_handle<> h;
+    bool operator>(const Timer& other) const { return (int32_t)(due_ms - other.due_ms) > 0; }
+  };
+  std::vector<MAX17263AsyncBus*> buses;
+  std::vector<MAX17263Task<bool>*> tasks;
+  std::deque<std::coroutine_handle<>> ready;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+};
+
+// Coroutine versions of the driver sequences for one gauge, battery parameters as in MAX17263.
+// initialize() writes the configuration image of MAX17263 with the EZ model; there is no custom
+// model upload (MAX17263::customModel), a gauge with a custom model needs MAX17263::initialize().
+class MAX17263CoroGauge
+{
+public:
+  MAX17263CoroGauge(MAX17263EventLoop& loop, MAX17263AsyncBus& bus) : loop(loop), bus(bus) {}
+  MAX17263Task<bool> initialize();
+  MAX17263Task<bool> readSnapshot(MAX17263Snapshot& snapshot);
+  MAX17263Task<bool> saveLearnedParams(MAX17263LearnedParams& params);
+
+  byte modelID = 0;
+  bool r100 = 0, vChg = 0;
+  float rSense = 0.01, vEmpty = 3.3;
+  long designCap_mAh = 3000;
+  uint16_t ichgTerm = 0x0640;
+  bool swapAlert = false;
+  uint16_t readyTimeout_ms = 1000; // FStat.DNR and ModelCfg.Refresh waits
+  MAX17263Fault fault = faultNone; // of the last initialize()
+  bool modelRefreshSkipped = false; // last initialize() found the configuration still in place
+
+private:
+  MAX17263EventLoop& loop;
+  MAX17263AsyncBus& bus;
+  MAX17263Task<bool> read(byte reg, uint16_t* values, byte count = 1);
+  MAX17263Task<bool> write(byte reg, uint16_t value);
+  MAX17263Task<bool> waitUntilClear(byte reg, uint16_t mask, MAX17263Fault timeoutFault);
+  MAX17263Task<bool> writeConfig(const MAX17263ConfigEntry* image, byte size, MAX17263& driver);
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+MIT License
+
+MAX17263Bus for Linux i2c-dev, see MAX17263LinuxI2C.h
+*/
+
+#include "MAX17263LinuxI2C.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+MAX17263LinuxI2C::MAX17263LinuxI2C(const char* device)
+{ fd = open(device, O_RDWR);
+}
+
+MAX17263LinuxI2C::~MAX17263LinuxI2C()
+{ if(fd >= 0) close(fd);
+}
+
+// Register address write and data read with a repeated start, in one I2C_RDWR ioctl
+bool MAX17263LinuxI2C::readRegs(byte address, byte reg, uint16_t* values, byte count)
+{ uint8_t buf[2 * 255];
+  i2c_msg msgs[2] = {{address, 0, 1, &reg}, {address, I2C_M_RD, (uint16_t)(2 * count), buf}};
+  i2c_rdwr_ioctl_data data = {msgs, 2};
+  if(ioctl(fd, I2C_RDWR, &data) != 2) return false;
+  for(byte i = 0; i < count; i++) values[i] = buf[2 * i] | (uint16_t)buf[2 * i + 1] << 8;
+  return true;
+}
+
+bool MAX17263LinuxI2C::writeRegs(byte address, byte reg, const uint16_t* values, byte count)
+{ uint8_t buf[1 + 2 * 255];
+  buf[0] = reg;
+  for(byte i = 0; i < count; i++)
+  { buf[1 + 2 * i] = values[i] & 0xFF; // LSB first
+    buf[2 + 2 * i] = values[i] >> 8;
+  }
+  i2c_msg msg = {address, 0, (uint16_t)(1 + 2 * count), buf};
+  i2c_rdwr_ioctl_data data = {&msg, 1};
+  return ioctl(fd, I2C_RDWR, &data) == 1;
+}
+
+bool MAX17263LinuxI2C::selectMuxChannel(byte muxAddress, byte channel)
+{ if(currentMux == muxAddress && currentChannel == channel) return true;
+  uint8_t mask = 1 << channel;
+  i2c_msg msg = {muxAddress, 0, 1, &mask};
+  i2c_rdwr_ioctl_data data = {&msg, 1};
+  if(ioctl(fd, I2C_RDWR, &data) != 1)
+  { currentMux = currentChannel = -1;
+    return false;
+  }
+  currentMux = muxAddress;
+  currentChannel = channel;
+  return true;
+}
@@ -0,0 +1,46 @@
+/*
+MIT License
+
+MAX17263Bus for Linux i2c-dev adapters (/dev/i2c-N), with optional TCA9548A style
+I2C multiplexer channels. One adapter must only be used from one thread.
+*/
+
+#ifndef MAX17263LinuxI2C_h
+#define MAX17263LinuxI2C_h
+
+#include "MAX17263Bus.h" // repository root, compile with -I../..
+
+class MAX17263LinuxI2C : public MAX17263Bus
+{
+public:
+  MAX17263LinuxI2C(const char* device); // e.g. "/dev/i2c-1"
+  ~MAX17263LinuxI2C();
+  bool isOpen() { return fd >= 0; }
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count);
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count);
+  bool selectMuxChannel(byte muxAddress, byte channel); // only writes the mux when the channel changes
+
+private:
+  int fd;
+  int currentMux = -1, currentChannel = -1;
+};
+
+// A gauge behind one channel of a multiplexer on an adapter
+class MAX17263MuxChannel : public MAX17263Bus
+{
+public:
+  MAX17263MuxChannel(MAX17263LinuxI2C& adapter, byte muxAddress, byte channel) :
+    adapter(adapter), muxAddress(muxAddress), channel(channel) {}
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count)
+  { return adapter.selectMuxChannel(muxAddress, channel) && adapter.readRegs(address, reg, values, count);
+  }
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count)
+  { return adapter.selectMuxChannel(muxAddress, channel) && adapter.writeRegs(address, reg, values, count);
+  }
+
+private:
+  MAX17263LinuxI2C& adapter;
+  byte muxAddress, channel;
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Simulated MAX17263, see MAX17263Sim.h
+*/
+
+#include "MAX17263Sim.h"
+
+MAX17263Sim::MAX17263Sim(MAX17263Clock& clock) : clock(clock)
+{ powerOnReset();
+}
+
+void MAX17263Sim::powerOnReset()
+{ memset(regs, 0, sizeof(regs));
+  memset(model, 0, sizeof(model));
+  regs[0x00] = 0x0002; // Status.POR
+  regs[0x3D] = 0x0001; // FStat.DNR
+  regs[0x18] = 0x0BB8; // DesignCap
+  regs[0x1E] = 0x0640; // IChgTerm
+  regs[0x3A] = 0xA561; // VEmpty 3.3V/3.88V
+  regs[0xBA] = 0x870C; // HibCfg
+  regs[0x2B] = 0x3870; // MiscCfg
+  regs[0x40] = 0x6070; // LEDCfg1
+  regs[0x4B] = 0x011F; // LEDCfg2
+  regs[0x1D] = 0x2210; // Config
+  regs[0x11] = 0xFFFF; // TimeToEmpty
+  regs[0x20] = 0xFFFF; // TimeToFull
+  regs[0x07] = 0x6400; // Age 100%
+  regs[0x1A] = 0x807F; // MaxMinTemp, reset values
+  regs[0x1B] = 0x00FF; // MaxMinVolt
+  regs[0x1C] = 0x807F; // MaxMinCurr
+  qh_mAh = discharged_mAh = 0;
+  lastUpdate_ms = clock.millis();
+  warmReset();
+}
+
+void MAX17263Sim::warmReset()
+{ regs[0x00] |= 0x0002; // Status.POR
+  regs[0x3D] |= 0x0001; // FStat.DNR
+  por_ms = timerStart_ms = clock.millis(); // Timer restarts
+  refreshBusy = quickstartBusy = false;
+  dataNotReady = true;
+  measure();
+  socStale = false; // the model starts again from the voltage
+}
+
+// ADC results of the simulated battery
+void MAX17263Sim::measure()
+{ uint16_t vcell = battery_V / 7.8125e-5;
+  int16_t current = current_mA / 1000 * rSense / 1.5625e-6;
+  regs[0x09] = regs[0x19] = vcell; // VCell, AvgVCell
+  regs[0x0A] = regs[0x0B] = current; // Current, AvgCurrent
+  regs[0x08] = (int16_t)(temp_C * 256); // Temp
+  regs[0xB1] = regs[0xB3] = (int16_t)(battery_V * current_mA * rSense / 8.0e-3); // Power, AvgPower
+  regs[0x16] = regs[0x08]; // AvgTA
+  int8_t maxTemp = regs[0x1A] >> 8, minTemp = regs[0x1A], t = temp_C;
+  regs[0x1A] = (byte)(t > maxTemp ? t : maxTemp) << 8 | (byte)(t < minTemp ? t : minTemp); // MaxMinTemp
+  byte maxVolt = regs[0x1B] >> 8, minVolt = regs[0x1B], v = vcell / 256; // 20mV
+  regs[0x1B] = (v > maxVolt ? v : maxVolt) << 8 | (v < minVolt ? v : minVolt); // MaxMinVolt
+  int8_t maxCurr = regs[0x1C] >> 8, minCurr = regs[0x1C], c = current / 256; // 0.4mV/rSense
+  regs[0x1C] = (byte)(c > maxCurr ? c : maxCurr) << 8 | (byte)(c < minCurr ? c : minCurr); // MaxMinCurr
+  uint32_t timer = (uint32_t)((clock.millis() - timerStart_ms) * (1 + timerError_ppm * 1e-6) / 175.8);
+  regs[0x3E] = timer; // Timer
+  regs[0xBE] = timer >> 16; // TimerH, 65536 x 175.8ms = 3.2 hours
+  if(batteryPresent) regs[0x00] &= ~0x0008; // Status.BSt
+  else regs[0x00] |= 0x0008;
+  if(batteryPresent != lastPresent) regs[0x00] |= batteryPresent ? 0x0800 : 0x8000; // Status.BI, BR
+  if(batteryPresent && !lastPresent) socStale = true;
+  lastPresent = batteryPresent;
+}
+
+// SOC of the battery model, or a simple linear OCV model: 3.0V = 0%, 4.2V = 100%
+void MAX17263Sim::estimateSOC()
+{ float soc = soc_percent >= 0 ? soc_percent : (battery_V - 3.0) / 1.2 * 100;
+  model_ms = clock.millis();
+  if(socStale) return;
+  if(soc < 0) soc = 0;
+  if(soc > 100) soc = 100;
+  regs[0x06] = soc * 256; // RepSOC
+  regs[0x05] = soc / 100 * regs[0x18]; // RepCap from DesignCap
+  regs[0x10] = regs[0x23] = regs[0x18]; // FullCapRep, FullCapNom, a new cell
+  if(current_mA > 0)
+  { float hours = ((regs[0x10] - regs[0x05]) * 5.0e-3 / rSense) / current_mA;
+    float ttf = hours * 3600 / 5.625;
+    regs[0x20] = ttf > 0xFFFE ? 0xFFFE : (uint16_t)ttf;
+  }
+  else regs[0x20] = 0xFFFF;
+  if(current_mA < 0)
+  { float hours = (regs[0x05] * 5.0e-3 / rSense) / -current_mA;
+    float tte = hours * 3600 / 5.625;
+    regs[0x11] = tte > 0xFFFE ? 0xFFFE : (uint16_t)tte;
+  }
+  else regs[0x11] = 0xFFFF;
+}
+
+// Coulomb counter QH and Cycles, discharge only: 100% of FullCapRep is one cycle, LSB 16%
+void MAX17263Sim::count()
+{ uint32_t now = clock.millis();
+  double charge_mAh = current_mA * (uint32_t)(now - lastUpdate_ms) / 3600000.0;
+  lastUpdate_ms = now;
+  qh_mAh += charge_mAh;
+  if(charge_mAh < 0) discharged_mAh -= charge_mAh;
+  double lsb_mAh = 5.0e-3 / rSense;
+  regs[0x4D] = (int16_t)(qh_mAh / lsb_mAh); // QH
+  if(regs[0x10]) regs[0x17] = (uint16_t)(discharged_mAh / (regs[0x10] * lsb_mAh) * 100 / 16); // Cycles
+}
+
+void MAX17263Sim::update()
+{ uint32_t now = clock.millis();
+  count();
+  measure();
+  if(dataNotReady && !dnrStuck && now - por_ms >= dataReady_ms)
+  { dataNotReady = false;
+    regs[0x3D] &= ~0x0001;
+    estimateSOC();
+  }
+  if(!dataNotReady && now - model_ms >= 5625) estimateSOC(); // model output period
+  if(refreshBusy && now - refresh_ms >= modelRefresh_ms)
+  { refreshBusy = false;
+    regs[0xDB] &= ~0x8000;
+    socStale = false;
+    estimateSOC();
+  }
+  if(quickstartBusy && now - quickstartStart_ms >= quickstart_ms)
+  { quickstartBusy = false;
+    regs[0x2B] &= ~0x0400;
+    socStale = false;
+    estimateSOC();
+  }
+}
+
+bool MAX17263Sim::alert()
+{ update();
+  uint16_t config = regs[0x1D], status = regs[0x00];
+  return (config & 0x0004) && (((config & 0x0001) && (status & 0x8000)) || ((config & 0x0002) && (status & 0x0800)));
+}
+
+uint16_t MAX17263Sim::read(byte reg)
+{ update();
+  if(reg >= 0x80 && reg <= 0xAF) return modelUnlocked() ? model[reg - 0x80] : 0; // locked model table reads as zeros
+  return regs[reg];
+}
+
+void MAX17263Sim::write(byte reg, uint16_t value)
+{ update();
+  if(reg >= 0x80 && reg <= 0xAF)
+  { if(modelUnlocked()) model[reg - 0x80] = value;
+    return;
+  }
+  regs[reg] = value;
+  if(reg == 0xDB && (value & 0x8000)) // ModelCfg.Refresh
+  { refreshBusy = true;
+    refresh_ms = clock.millis();
+  }
+  if(reg == 0x2B && (value & 0x0400)) // MiscCfg.QS
+  { quickstartBusy = true;
+    quickstartStart_ms = clock.millis();
+  }
+  if(reg == 0x3D) regs[0x3D] = (regs[0x3D] & ~0x0001) | dataNotReady; // DNR is read only
+  measure();
+}
+
+MAX17263I2CTiming max17263I2CTiming(uint32_t clock_Hz, uint16_t riseTime_ns)
+{ //                         tLOW   tHIGH  tHD;STA tSU;STA tSU;STO tBUF
+  static const uint16_t standard[6] = {4700, 4000, 4000, 4700, 4000, 4700},
+                        fast[6]     = {1300,  600,  600,  600,  600, 1300},
+                        fastPlus[6] = { 500,  260,  260,  260,  260,  500};
+  const uint16_t* t = clock_Hz <= 100000 ? standard : clock_Hz <= 400000 ? fast : fastPlus;
+  uint32_t period_ns = (1000000000ULL + clock_Hz - 1) / clock_Hz;
+  if(period_ns < (uint32_t)t[0] + t[1]) period_ns = t[0] + t[1];
+  return {period_ns + riseTime_ns, t[2], t[3], t[4], t[5]};
+}
+
+uint32_t MAX17263SimBus::transactionTime_ns(bool write, byte count)
+{ MAX17263I2CTiming t = max17263I2CTiming(clock_Hz, riseTime_ns);
+  uint32_t bytes = write ? 2 + 2 * count : 3 + 2 * count;
+  uint32_t ns = t.buf_ns + t.hdSta_ns; // START
+  ns += bytes * (9 * t.bit_ns + stretch_ns) + (bytes - 1) * byteGap_ns;
+  if(!write) ns += t.bit_ns / 2 + t.suSta_ns + t.hdSta_ns; // repeated START: SCL low, high, SDA falls
+  return ns + t.bit_ns / 2 + t.suSto_ns; // STOP
+}
+
+// Wire time of a transaction, also a failed one
+void MAX17263SimBus::account(uint32_t ns)
+{ uint64_t start_us = wireTime_ns / 1000;
+  wireTime_ns += ns + latency_us * 1000ULL;
+  uint32_t us = wireTime_ns / 1000 - start_us; // the remainder is carried, the clock does not drift
+  lastTransaction_ns = ns;
+  lastTransaction_us = (ns + 999) / 1000 + latency_us;
+  transactions++;
+  wireTime_us = wireTime_ns / 1000;
+  if(sleepWireTime) clock.delayMicroseconds(us);
+}
+
+// Injected bus faults, true if this transaction fails, with the wire time until the controller gives up
+bool MAX17263SimBus::fail(bool write, byte count)
+{ MAX17263I2CTiming t = max17263I2CTiming(clock_Hz, riseTime_ns);
+  uint32_t ns;
+  if(sdaStuckLow) ns = stuckTimeout_us * 1000;
+  else if(nakCount)
+  { nakCount--;
+    ns = t.buf_ns + t.hdSta_ns + 9 * t.bit_ns + t.bit_ns / 2 + t.suSto_ns; // address + NAK, STOP
+  }
+  else if(!write && shortReadCount)
+  { shortReadCount--;
+    ns = transactionTime_ns(false, count) - (2 * count - 1) * 9 * t.bit_ns; // one data byte
+  }
+  else return false;
+  account(ns);
+  failed++;
+  return true;
+}
+
+bool MAX17263SimBus::clearBus()
+{ MAX17263I2CTiming t = max17263I2CTiming(clock_Hz, riseTime_ns);
+  clears++;
+  byte clocks = sdaStuckLow && sdaReleaseClocks ? sdaReleaseClocks : 9;
+  if(sdaReleaseClocks) sdaStuckLow = false;
+  account(clocks * t.bit_ns + t.bit_ns / 2 + t.suSto_ns);
+  transactions--; // not a transaction of the gauge
+  return !sdaStuckLow;
+}
+
+bool MAX17263SimBus::readRegs(byte address, byte reg, uint16_t* values, byte count)
+{ if(fail(false, count)) return false;
+  account(transactionTime_ns(false, count));
+  if(address != 0x36) return false;
+  for(byte i = 0; i < count; i++) values[i] = sim.read(reg + i);
+  return true;
+}
+
+bool MAX17263SimBus::writeRegs(byte address, byte reg, const uint16_t* values, byte count)
+{ if(fail(true, count)) return false;
+  account(transactionTime_ns(true, count));
+  if(address != 0x36) return false;
+  for(byte i = 0; i < count; i++) sim.write(reg + i, values[i]);
+  return true;
+}
+
+void MAX17263SimAsyncBackend::start(byte address, MAX17263Transaction& t)
+{ bool sleep = bus.sleepWireTime;
+  bus.sleepWireTime = false;
+  result = t.write ? bus.writeRegs(address, t.reg, t.values, t.count) : bus.readRegs(address, t.reg, t.values, t.count);
+  bus.sleepWireTime = sleep;
+  done_us = bus.clock.micros() + bus.lastTransaction_us;
+}
+
+bool MAX17263SimAsyncBackend::complete(MAX17263Transaction& t, bool& ok)
+{ if((int32_t)(bus.clock.micros() - done_us) < 0) return false;
+  ok = result;
+  return true;
+}
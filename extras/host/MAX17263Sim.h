@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Simulated MAX17263 for running the driver on a Linux host without hardware.
+It models the register file and the behaviour the driver depends on:
+POR flag, FStat.DNR after power up, the ModelCfg.Refresh and MiscCfg.QS (Quickstart)
+handshakes, the model table lock (0x62/0x63) and a battery with a fixed voltage and current.
+The extended measurements (FullCapRep, TimeToFull, MaxMin*, AvgTA, Timer/TimerH) follow it.
+Timings are approximations, they can be changed per instance. The time comes from a
+MAX17263Clock, with a MAX17263VirtualClock the simulation runs faster than real time.
+Cycles and QH count the charge that flows, the model outputs (RepSOC, RepCap, TTE, TTF)
+are updated every 5.625s.
+A change of batteryPresent sets Status.BR (removal) or Status.BI (insertion), alert() is the
+ALRT pin with Config.Aen. After an insertion the model outputs keep the SOC of the old battery
+until a Quickstart, a ModelCfg refresh or a reset estimates it again from the new voltage; the
+real gauge corrects it slowly over hours, the simulation not at all.
+*/
+
+#ifndef MAX17263Sim_h
+#define MAX17263Sim_h
+
+#include "MAX17263Bus.h" // repository root, compile with -I../..
+#include "MAX17263Clock.h"
+#include "MAX17263Async.h"
+
+class MAX17263Sim
+{
+public:
+  MAX17263Sim(MAX17263Clock& clock = MAX17263System);
+  void powerOnReset(); // register defaults, Status.POR and FStat.DNR set
+  void warmReset(); // brown-out: Status.POR and FStat.DNR set, configuration registers kept
+  uint16_t read(byte reg);
+  void write(byte reg, uint16_t value);
+  void update(); // process pending handshakes, called on every bus access
+  bool alert(); // ALRT asserted: Config.Aen and a battery removal (Ber) or insertion (Bei) in Status
+
+  // battery and sense resistor seen by the gauge
+  float battery_V = 3.9, current_mA = 0, rSense = 0.01, temp_C = 25;
+  bool batteryPresent = true;
+  float soc_percent = -1; // from a battery model (MAX17263Battery.h), -1: estimated from battery_V
+  float timerError_ppm = 0; // Timer/TimerH run this much fast, the chip oscillator is not exact
+  bool dnrStuck = false; // injected fault: FStat.DNR does not clear after a reset
+
+  // approximated chip timings
+  uint16_t dataReady_ms = 250;   // POR until FStat.DNR = 0
+  uint16_t modelRefresh_ms = 300; // ModelCfg.Refresh set until cleared
+  uint16_t quickstart_ms = 200;   // MiscCfg.QS set until cleared
+
+  MAX17263Clock& clock;
+  uint16_t regs[256];
+  uint16_t model[48]; // 0x80..0xAF, only accessible while unlocked
+  bool modelUnlocked() { return regs[0x62] == 0x0059 && regs[0x63] == 0x00C4; }
+
+private:
+  uint32_t por_ms, refresh_ms, quickstartStart_ms, timerStart_ms, lastUpdate_ms, model_ms;
+  double qh_mAh, discharged_mAh; // since the POR
+  bool refreshBusy, quickstartBusy, dataNotReady;
+  bool lastPresent = true, socStale = false; // socStale: a battery was inserted, RepSOC is of the old one
+  void measure();
+  void estimateSOC();
+  void count();
+};
+
+// I2C timing of one bus speed, minimum values of the I2C specification (NXP UM10204) for
+// Standard-mode (<= 100kHz), Fast-mode (<= 400kHz) or Fast-mode Plus (<= 1MHz, beyond the 400kHz
+// of the MAX17263, for comparison).
+// The SCL period is the nominal one or tLOW + tHIGH if longer, plus the rise time: the
+// controller counts the high phase from the moment it sees SCL high.
+struct MAX17263I2CTiming
+{ uint32_t bit_ns;   // SCL period
+  uint16_t hdSta_ns; // START hold, SDA low to SCL low
+  uint16_t suSta_ns; // repeated START setup, SCL high to SDA low
+  uint16_t suSto_ns; // STOP setup, SCL high to SDA high
+  uint16_t buf_ns;   // bus free between STOP and the next START
+};
+MAX17263I2CTiming max17263I2CTiming(uint32_t clock_Hz, uint16_t riseTime_ns = 0);
+
+// One simulated gauge behind a bus, each transaction takes its I2C wire time on the clock of the gauge:
+//   bus free, START, address+W + ACK, register + ACK, [repeated START, address+R + ACK], 2 x count data bytes
+//   + ACK/NACK, STOP, 9 SCL periods per byte. stretch_ns is added to every byte the gauge acknowledges or
+//   sends (clock stretching, the MAX17263 does not stretch), byteGap_ns between the bytes (controller).
+class MAX17263SimBus : public MAX17263Bus
+{
+public:
+  MAX17263SimBus(MAX17263Sim& sim) : clock(sim.clock), sim(sim) {}
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count);
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count);
+  bool clearBus(); // 9 clocks and a STOP, frees SDA after sdaReleaseClocks
+  uint32_t transactionTime_ns(bool write, byte count); // wire time of one call, without latency_us
+
+  uint32_t clock_Hz = 400000; // 100000, 400000 or 1000000, the timing follows the mode
+  uint16_t riseTime_ns = 0; // SCL rise time, about 0.85 x pull-up x bus capacitance
+  uint16_t stretch_ns = 0, byteGap_ns = 0;
+  uint32_t latency_us = 0; // injected per transaction, e.g. driver or scheduling overhead
+  bool sleepWireTime = true; // let the calling thread wait for the transaction, like on a real bus
+  uint32_t transactions = 0;
+  uint64_t wireTime_ns = 0, wireTime_us = 0; // with latency_us
+  uint32_t lastTransaction_us = 0; // wire time + latency of the last transaction, rounded up
+  uint32_t lastTransaction_ns = 0; // wire time of the last transaction
+  MAX17263Clock& clock;
+
+  // injected faults
+  uint32_t nakCount = 0; // the next transactions are not acknowledged, the address byte only
+  uint32_t shortReadCount = 0; // the next reads end after the first data byte
+  bool sdaStuckLow = false; // the gauge holds SDA low, no START until clearBus()
+  byte sdaReleaseClocks = 9; // SCL clocks of clearBus() until SDA is released, 0 = never
+  uint32_t stuckTimeout_us = 25000; // a transaction on a stuck bus fails after the controller timeout, like Wire
+  uint32_t failed = 0, clears = 0; // transactions that failed, clearBus() calls
+
+private:
+  MAX17263Sim& sim;
+  void account(uint32_t ns);
+  bool fail(bool write, byte count);
+};
+
+// Non-blocking backend for MAX17263AsyncBus: the transaction completes after the wire time
+// and injected latency of the SimBus, the calling thread is free in the meantime
+class MAX17263SimAsyncBackend : public MAX17263AsyncBackend
+{
+public:
+  MAX17263SimAsyncBackend(MAX17263SimBus& bus) : bus(bus) {}
+  void start(byte address, MAX17263Transaction& t);
+  bool complete(MAX17263Transaction& t, bool& ok);
+
+private:
+  MAX17263SimBus& bus;
+  uint32_t done_us;
+  bool result;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Chip time line of snapshots, see MAX17263Timeline.h
+*/
+
+#include "MAX17263Timeline.h"
+#include <math.h>
+
+// Least squares fit of the MCU time against the chip time of the samples of one gauge and epoch
+static void alignEpoch(std::vector<MAX17263TimedSample*>& epoch, const std::vector<double>& mcu_ms,
+                       MAX17263GaugeTiming& timing, double& squares)
+{ size_t n = epoch.size();
+  double meanX = 0, meanY = 0;
+  for(size_t i = 0; i < n; i++)
+  { meanX += epoch[i]->chip_s / n;
+    meanY += mcu_ms[i] / n;
+  }
+  double sxx = 0, sxy = 0;
+  for(size_t i = 0; i < n; i++)
+  { sxx += (epoch[i]->chip_s - meanX) * (epoch[i]->chip_s - meanX);
+    sxy += (epoch[i]->chip_s - meanX) * (mcu_ms[i] - meanY);
+  }
+  double slope = sxx > 0 ? sxy / sxx : 1000; // ms per chip second
+  for(size_t i = 0; i < n; i++)
+  { epoch[i]->aligned_ms = meanY + slope * (epoch[i]->chip_s - meanX);
+    double residual = mcu_ms[i] - epoch[i]->aligned_ms;
+    squares += residual * residual;
+    if(i)
+    { double error = fabs((mcu_ms[i] - mcu_ms[i - 1]) - slope * epoch[i]->spacing_s);
+      if(error > timing.maxSpacingError_ms) timing.maxSpacingError_ms = error;
+    }
+  }
+  timing.rate_ppm = (1000 / slope - 1) * 1e6;
+  double span_s = epoch.back()->chip_s - epoch.front()->chip_s;
+  timing.rateResolution_ppm = span_s > 0 ? MAX17263Tick_s / span_s * 1e6 : 1e6;
+}
+
+void MAX17263AnalyseTimeline(std::vector<MAX17263TimedSample>& samples, std::map<int, MAX17263GaugeTiming>& gauges)
+{ std::map<int, std::vector<MAX17263TimedSample*>> perGauge;
+  for(MAX17263TimedSample& s : samples) perGauge[s.gauge].push_back(&s);
+  gauges.clear();
+  for(auto& g : perGauge)
+  { MAX17263GaugeTiming& timing = gauges[g.first];
+    std::vector<MAX17263TimedSample*> epoch;
+    std::vector<double> mcu_ms; // unwrapped millis() of the epoch
+    double squares = 0;
+    double unwrapped_ms = samples.front().time_ms + (double)(int32_t)(g.second[0]->time_ms - samples.front().time_ms);
+    for(size_t i = 0; i < g.second.size(); i++)
+    { MAX17263TimedSample& s = *g.second[i];
+      s.chip_s = MAX17263ChipTime_s(s.timer, s.timerH);
+      if(i) unwrapped_ms += (uint32_t)(s.time_ms - g.second[i - 1]->time_ms);
+      bool reset = !epoch.empty() && s.chip_s < epoch.back()->chip_s; // POR, the Timer restarted
+      if(reset)
+      { alignEpoch(epoch, mcu_ms, timing, squares);
+        epoch.clear();
+        mcu_ms.clear();
+        timing.resets++;
+      }
+      s.epoch = timing.resets;
+      s.spacing_s = epoch.empty() ? 0 : s.chip_s - epoch.back()->chip_s;
+      s.duplicate = !epoch.empty() && s.timer == epoch.back()->timer && s.timerH == epoch.back()->timerH;
+      timing.duplicates += s.duplicate;
+      timing.samples++;
+      epoch.push_back(&s);
+      mcu_ms.push_back(unwrapped_ms);
+    }
+    alignEpoch(epoch, mcu_ms, timing, squares);
+    timing.jitter_ms = sqrt(squares / timing.samples);
+  }
+}
+
+bool loadTimeline(std::vector<MAX17263TimedSample>& samples, const char* path)
+{ FILE* f = fopen(path, "r");
+  if(!f) return false;
+  char line[256];
+  while(fgets(line, sizeof(line), f))
+  { if(line[0] == '#' || line[0] == '\n') continue;
+    MAX17263TimedSample s = {};
+    unsigned timer, timerH;
+    if(sscanf(line, "%d,%u,%u,%u", &s.gauge, &s.time_ms, &timer, &timerH) != 4) continue;
+    s.timer = timer;
+    s.timerH = timerH;
+    samples.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+void printTimedSample(FILE* out, const MAX17263TimedSample& s)
+{ fprintf(out, "%d,%u,%u,%u", s.gauge, s.time_ms, s.timer, s.timerH);
+}
@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Time line of snapshots tagged with the chip time (MAX17263Snapshot timer and timerH).
+The MCU timestamps (millis() of the read) jitter with the loop, the gauge Timer does not:
+it counts the 175.8ms ADC conversions. MAX17263AnalyseTimeline() uses it to
+- rebuild the exact spacing of the samples of a gauge, also across Timer roll overs
+- flag samples that read the same conversion as the previous one (same Timer tick)
+- detect a POR of the gauge, the chip time restarts, a new epoch begins
+- map the chip time of all gauges onto one time line: per gauge and epoch a least squares fit
+  of the MCU timestamps against the chip time, so the loop jitter averages out and the
+  gauges are aligned by their own clock, corrected for its rate error.
+
+CSV of the samples, one line per snapshot, '#' lines are comments, extra columns are ignored:
+  gauge,time_ms,timer,timerH
+*/
+
+#ifndef MAX17263Timeline_h
+#define MAX17263Timeline_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+const double MAX17263Tick_s = 0.1758; // Timer LSB, one ADC conversion
+
+inline double MAX17263ChipTime_s(uint16_t timer, uint16_t timerH)
+{ return ((uint32_t)timerH << 16 | timer) * MAX17263Tick_s;
+}
+
+struct MAX17263TimedSample
+{ int gauge;
+  uint32_t time_ms; // MCU millis() of the read, may wrap
+  uint16_t timer, timerH;
+  // set by MAX17263AnalyseTimeline()
+  int epoch; // POR count of the gauge in this log
+  double chip_s; // chip time since the POR
+  double spacing_s; // chip time since the previous sample of the gauge and epoch, 0 for the first
+  bool duplicate; // same Timer tick as the previous sample: the same conversion was read again
+  double aligned_ms; // chip time on the common time line, MCU time base without the jitter
+};
+
+struct MAX17263GaugeTiming
+{ int samples = 0, duplicates = 0, resets = 0;
+  double rate_ppm = 0; // chip clock relative to the MCU clock, of the last epoch
+  double rateResolution_ppm = 0; // one Timer tick over the length of the last epoch
+  double jitter_ms = 0; // rms of the MCU timestamps around the fitted time line, all epochs,
+                        // includes the Timer resolution, 175.8ms uniform is 51ms rms
+  double maxSpacingError_ms = 0; // largest MCU spacing error against the chip spacing
+};
+
+void MAX17263AnalyseTimeline(std::vector<MAX17263TimedSample>& samples, std::map<int, MAX17263GaugeTiming>& gauges);
+bool loadTimeline(std::vector<MAX17263TimedSample>& samples, const char* path);
+void printTimedSample(FILE* out, const MAX17263TimedSample& s); // one CSV line, without the newline
+
+#endif
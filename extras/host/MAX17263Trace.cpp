@@ -0,0 +1,158 @@
+/*
+MIT License
+
+Bus trace recorder and replay, see MAX17263Trace.h
+*/
+
+#include "MAX17263Trace.h"
+#include <string.h>
+
+static const char traceMagic[4] = {'M', '1', '7', 'T'};
+static const byte traceVersion = 1;
+
+static void put32(byte* p, uint32_t v)
+{ p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t get32(const byte* p)
+{ return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool saveTrace(const MAX17263Trace& trace, const char* path)
+{ FILE* f = fopen(path, "wb");
+  if(!f) return false;
+  byte header[8] = {0};
+  memcpy(header, traceMagic, 4);
+  header[4] = traceVersion;
+  bool ok = fwrite(header, 1, 8, f) == 8;
+  uint32_t last_us = 0;
+  for(const MAX17263TraceRecord& r : trace)
+  { byte buffer[8 + 2 * 255];
+    byte count = r.values.size();
+    put32(buffer, r.time_us - last_us);
+    buffer[4] = r.address;
+    buffer[5] = r.reg;
+    buffer[6] = r.write | r.ok << 1;
+    buffer[7] = count;
+    for(byte i = 0; i < count; i++)
+    { buffer[8 + 2 * i] = r.values[i] & 0xFF;
+      buffer[9 + 2 * i] = r.values[i] >> 8;
+    }
+    ok &= fwrite(buffer, 1, 8 + 2 * count, f) == (size_t)(8 + 2 * count);
+    last_us = r.time_us;
+  }
+  return fclose(f) == 0 && ok;
+}
+
+bool loadTrace(MAX17263Trace& trace, const char* path)
+{ trace.clear();
+  FILE* f = fopen(path, "rb");
+  if(!f) return false;
+  byte header[8];
+  bool ok = fread(header, 1, 8, f) == 8 && !memcmp(header, traceMagic, 4) && header[4] == traceVersion;
+  uint32_t time_us = 0;
+  byte buffer[2 * 255];
+  while(ok && fread(header, 1, 8, f) == 8)
+  { MAX17263TraceRecord r;
+    time_us += get32(header);
+    r.time_us = time_us;
+    r.address = header[4];
+    r.reg = header[5];
+    r.write = header[6] & 1;
+    r.ok = header[6] & 2;
+    byte count = header[7];
+    ok = fread(buffer, 1, 2 * count, f) == (size_t)(2 * count);
+    for(byte i = 0; i < count; i++) r.values.push_back(buffer[2 * i] | buffer[2 * i + 1] << 8);
+    trace.push_back(r);
+  }
+  fclose(f);
+  return ok;
+}
+
+void printRecord(FILE* out, const MAX17263TraceRecord& r)
+{ fprintf(out, "%c 0x%02X", r.write ? 'W' : 'R', r.reg);
+  for(uint16_t v : r.values) fprintf(out, " 0x%04X", v);
+  if(r.address != 0x36) fprintf(out, " @0x%02X", r.address);
+  if(!r.ok) fprintf(out, " NAK");
+}
+
+void MAX17263TraceRecorder::record(byte address, byte reg, bool write, bool ok, const uint16_t* values, byte count)
+{ uint32_t now_us = micros();
+  if(!started)
+  { start_us = now_us;
+    started = true;
+  }
+  MAX17263TraceRecord r;
+  r.time_us = now_us - start_us;
+  r.address = address;
+  r.reg = reg;
+  r.write = write;
+  r.ok = ok;
+  r.values.assign(values, values + count);
+  trace.push_back(r);
+}
+
+bool MAX17263TraceRecorder::readRegs(byte address, byte reg, uint16_t* values, byte count)
+{ bool ok = bus.readRegs(address, reg, values, count);
+  record(address, reg, false, ok, values, count);
+  return ok;
+}
+
+bool MAX17263TraceRecorder::writeRegs(byte address, byte reg, const uint16_t* values, byte count)
+{ bool ok = bus.writeRegs(address, reg, values, count);
+  record(address, reg, true, ok, values, count);
+  return ok;
+}
+
+void MAX17263TraceReplay::rewind()
+{ position = 0;
+  transfers = skipped = divergences = writeMismatches = 0;
+  memset(shadow, 0, sizeof(shadow));
+  bool seen[256] = {false};
+  for(const MAX17263TraceRecord& r : trace) // registers start with their first value in the trace
+    for(size_t i = 0; i < r.values.size(); i++)
+    { byte reg = r.reg + i;
+      if(!seen[reg] && r.ok) shadow[reg] = r.values[i];
+      seen[reg] |= r.ok;
+    }
+}
+
+// The record for the wanted transfer, or 0 when it is not within resyncWindow records
+const MAX17263TraceRecord* MAX17263TraceReplay::next(const MAX17263TraceRecord& wanted)
+{ transfers++;
+  for(size_t i = position; i < trace.size() && i <= position + resyncWindow; i++)
+  { if(!trace[i].sameTransfer(wanted)) continue;
+    for(; position < i; position++, skipped++) // keep the shadow registers up to date
+      if(trace[position].ok)
+        for(size_t j = 0; j < trace[position].values.size(); j++) shadow[(byte)(trace[position].reg + j)] = trace[position].values[j];
+    return &trace[position++];
+  }
+  divergences++;
+  return 0;
+}
+
+bool MAX17263TraceReplay::readRegs(byte address, byte reg, uint16_t* values, byte count)
+{ MAX17263TraceRecord wanted;
+  wanted.address = address;
+  wanted.reg = reg;
+  wanted.write = false;
+  wanted.values.resize(count);
+  const MAX17263TraceRecord* r = next(wanted);
+  for(byte i = 0; i < count; i++)
+  { if(r) shadow[(byte)(reg + i)] = r->values[i];
+    values[i] = shadow[(byte)(reg + i)];
+  }
+  return r ? r->ok : true;
+}
+
+bool MAX17263TraceReplay::writeRegs(byte address, byte reg, const uint16_t* values, byte count)
+{ MAX17263TraceRecord wanted;
+  wanted.address = address;
+  wanted.reg = reg;
+  wanted.write = true;
+  wanted.values.resize(count);
+  const MAX17263TraceRecord* r = next(wanted);
+  if(r && memcmp(r->values.data(), values, 2 * count)) writeMismatches++;
+  for(byte i = 0; i < count; i++) shadow[(byte)(reg + i)] = values[i];
+  return r ? r->ok : true;
+}
@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Bus trace recorder and deterministic replay.
+MAX17263TraceRecorder sits between the driver and any MAX17263Bus and records every transaction:
+time, address, register, direction, result and the 16 bit words. MAX17263TraceReplay is a
+MAX17263Bus that plays a recorded trace back to the driver, so a field incident captured once
+can be replayed many times without hardware, with the same register values in the same order.
+
+Binary trace file, little endian:
+  header  "M17T" version(1) reserved(3)
+  record  dt_us(4) address(1) reg(1) flags(1) count(1) words(2*count)
+          dt_us is the time since the previous record, flags bit0 write, bit1 ok
+A record is 8 bytes plus the words, so a RepCap..Current burst costs 20 bytes.
+*/
+
+#ifndef MAX17263Trace_h
+#define MAX17263Trace_h
+
+#include "MAX17263Bus.h" // repository root, compile with -I../..
+#include <stdio.h>
+#include <vector>
+
+struct MAX17263TraceRecord
+{ uint32_t time_us; // since the start of the trace
+  byte address, reg;
+  bool write, ok;
+  std::vector<uint16_t> values;
+
+  bool sameTransfer(const MAX17263TraceRecord& other) const // same direction, address, registers
+  { return write == other.write && address == other.address && reg == other.reg && values.size() == other.values.size();
+  }
+};
+
+typedef std::vector<MAX17263TraceRecord> MAX17263Trace;
+
+bool saveTrace(const MAX17263Trace& trace, const char* path);
+bool loadTrace(MAX17263Trace& trace, const char* path);
+void printRecord(FILE* out, const MAX17263TraceRecord& r); // one line, e.g. "W 0xBA 0x0000"
+
+class MAX17263TraceRecorder : public MAX17263Bus
+{
+public:
+  MAX17263TraceRecorder(MAX17263Bus& bus) : bus(bus) {}
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count);
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count);
+  void clear() { trace.clear(); started = false; }
+
+  MAX17263Trace trace;
+
+private:
+  MAX17263Bus& bus;
+  bool started = false;
+  uint32_t start_us;
+  void record(byte address, byte reg, bool write, bool ok, const uint16_t* values, byte count);
+};
+
+// Plays the reads of a trace back in order. When the driver asks for a transfer that is not the
+// next record (changed driver code), up to resyncWindow records are skipped to find it; without
+// a match the read is answered from the register values seen so far and counted as a divergence.
+class MAX17263TraceReplay : public MAX17263Bus
+{
+public:
+  MAX17263TraceReplay(const MAX17263Trace& trace) : trace(trace) { rewind(); }
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count);
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count);
+  void rewind(); // for the next replay run
+  bool finished() { return position >= trace.size(); }
+
+  uint16_t resyncWindow = 16;
+  uint32_t transfers, skipped, divergences, writeMismatches; // since rewind()
+
+private:
+  const MAX17263Trace& trace;
+  size_t position;
+  uint16_t shadow[256];
+  const MAX17263TraceRecord* next(const MAX17263TraceRecord& wanted);
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+MIT License
+
+Virtual time for the driver and the simulator: delay() and delayMicroseconds() do not wait,
+they move the clock ahead. A driver and a MAX17263Sim that share one MAX17263VirtualClock
+run as fast as the CPU allows, e.g. days of operation in seconds. One clock per gauge,
+it is not thread safe, a thread per group of gauges is.
+
+  MAX17263VirtualClock clock;
+  MAX17263Sim sim(clock);
+  MAX17263SimBus bus(sim); // the wire time moves the clock
+  gauge.begin(bus, clock);
+*/
+
+#ifndef MAX17263VirtualClock_h
+#define MAX17263VirtualClock_h
+
+#include "MAX17263Clock.h" // repository root, compile with -I../..
+
+class MAX17263VirtualClock : public MAX17263Clock
+{
+public:
+  MAX17263VirtualClock(uint64_t start_us = 0) : now_us(start_us) {}
+  uint32_t millis() { return now_us / 1000; }
+  uint32_t micros() { return now_us; }
+  void delay(uint32_t ms) { now_us += (uint64_t)ms * 1000; }
+  void delayMicroseconds(uint32_t us) { now_us += us; }
+  void advance_ms(uint64_t ms) { now_us += ms * 1000; } // time the sketch spends outside the driver
+  uint64_t now_us; // never wraps, millis() and micros() wrap like on the MCU
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+MIT License
+
+Measures how much of the gauge transfer time MAX17263AsyncBus overlaps with application work.
+Every iteration reads RepCap..Current (6 words) and does WORK_us of computation, first with the
+blocking bus, then with the async queue on the simulator backend. The blocking bus sleeps
+for the transfer and the host oversleeps, the async loop polls: the overlap is related to the
+measured time of the bare blocking transfer, on the same clock, not to the nominal wire time.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. async_bench.cpp ../../MAX17263Async.cpp ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp -o async_bench
+Usage:
+  async_bench [iterations] [WORK_us] [latency_us] [clock_Hz]
+*/
+
+#include "MAX17263Sim.h"
+#include <cstdio>
+#include <cstdlib>
+
+static volatile uint32_t sink;
+
+// Application work that does not need the bus
+static void work(uint32_t us)
+{ uint32_t start = micros();
+  while(micros() - start < us) sink++;
+}
+
+static void onSnapshot(MAX17263Transaction& t, void* context)
+{ ++*(uint32_t*)context;
+}
+
+int main(int argc, char** argv)
+{ int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+  uint32_t work_us = argc > 2 ? atoi(argv[2]) : 300;
+  MAX17263Sim sim;
+  MAX17263SimBus bus(sim);
+  bus.latency_us = argc > 3 ? atoi(argv[3]) : 100;
+  bus.clock_Hz = argc > 4 ? atoi(argv[4]) : 400000;
+  uint16_t values[6];
+
+  uint32_t t0 = micros();
+  for(int i = 0; i < iterations; i++) bus.readRegs(0x36, 0x05, values, 6); // bare transfer, with the oversleep
+  uint32_t bare_us = micros() - t0;
+
+  t0 = micros();
+  for(int i = 0; i < iterations; i++)
+  { bus.readRegs(0x36, 0x05, values, 6); // blocks for the wire time + latency
+    work(work_us);
+  }
+  uint32_t blocking_us = micros() - t0;
+  uint32_t transfer_us = bus.lastTransaction_us;
+
+  MAX17263SimAsyncBackend backend(bus);
+  MAX17263AsyncBus async(backend);
+  MAX17263Transaction t;
+  uint32_t callbacks = 0;
+  t0 = micros();
+  for(int i = 0; i < iterations; i++)
+  { t.prepareRead(0x05, values, 6, onSnapshot, &callbacks);
+    async.submit(t);
+    async.service(); // starts the transfer
+    work(work_us);
+    while(!t.ready()) async.service(); // normally returns at once, the transfer finished during work()
+  }
+  uint32_t async_us = micros() - t0;
+
+  // blocking = bare + work, async >= work, so at most the whole transfer overlaps; more is measurement noise
+  double overlap = 100.0 * ((double)blocking_us - async_us) / bare_us;
+  printf("transfer %u us (%.1f us measured), work %u us, %d iterations, %u callbacks\n", transfer_us,
+         (double)bare_us / iterations, work_us, iterations, callbacks);
+  printf("blocking: %.1f us/iteration\n", (double)blocking_us / iterations);
+  printf("async:    %.1f us/iteration, %.0f%% of the transfer time overlapped\n", (double)async_us / iterations,
+         overlap < 0 ? 0 : overlap > 100 ? 100 : overlap);
+  if(overlap > 105) printf("overlap %.0f%% > 100%%: the host clock is too noisy for this measurement\n", overlap);
+  return overlap <= 105 ? 0 : 1;
+}
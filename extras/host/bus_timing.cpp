@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Wire time of the driver calls on the I2C timing model of MAX17263SimBus, at 100kHz, 400kHz and
+1MHz: single register read and write, a burst, readSnapshot(), readMeasurements() and
+initialize(), to compare with a logic analyser capture. The time line of one register read
+lists the same edges as the capture: START, bytes with ACK, repeated START, STOP.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. bus_timing.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp -o bus_timing
+Usage:
+  bus_timing [RISE_ns] [STRETCH_ns] [BYTE_GAP_ns]   default 0 0 0, e.g. 300 for 2.2k pull-ups and 150pF
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <cstdio>
+#include <cstdlib>
+
+struct Bench
+{ MAX17263VirtualClock clock;
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+};
+
+// Wire time and transactions of one call
+static void measure(Bench& b, const char* name, void (*call)(Bench&))
+{ uint64_t ns = b.bus.wireTime_ns;
+  uint32_t transactions = b.bus.transactions;
+  call(b);
+  printf("  %-28s %10.1f us %4u transactions\n", name, (b.bus.wireTime_ns - ns) / 1000.0, b.bus.transactions - transactions);
+}
+
+static void readReg(Bench& b) { uint16_t v; b.bus.readRegs(0x36, 0x06, &v, 1); }
+static void writeReg(Bench& b) { uint16_t v = 0; b.bus.writeRegs(0x36, 0x07, &v, 1); }
+static void burst(Bench& b) { uint16_t v[7]; b.bus.readRegs(0x36, 0x05, v, 7); }
+static void snapshot(Bench& b) { MAX17263Snapshot s; b.gauge.readSnapshot(s); }
+static void measurements(Bench& b) { MAX17263Measurements m; b.gauge.readMeasurements(m); }
+static void initialize(Bench& b) { b.sim.powerOnReset(); b.gauge.initialize(); }
+
+// Edges of one register read, in us from the START
+static void timeline(const MAX17263SimBus& bus)
+{ MAX17263I2CTiming t = max17263I2CTiming(bus.clock_Hz, bus.riseTime_ns);
+  const char* bytes[5] = {"address+W", "register", "address+R", "data LSB", "data MSB"};
+  double ns = t.hdSta_ns;
+  printf("  %9.3f START (after %.3f us bus free)\n", 0.0, t.buf_ns / 1000.0);
+  for(int i = 0; i < 5; i++)
+  { if(i == 2)
+    { ns += t.bit_ns / 2 + t.suSta_ns;
+      printf("  %9.3f repeated START\n", ns / 1000);
+      ns += t.hdSta_ns;
+    }
+    ns += 9 * t.bit_ns + bus.stretch_ns;
+    printf("  %9.3f %s + %s\n", ns / 1000, bytes[i], i == 4 ? "NACK" : "ACK");
+    if(i < 4) ns += bus.byteGap_ns;
+  }
+  ns += t.bit_ns / 2 + t.suSto_ns;
+  printf("  %9.3f STOP\n", ns / 1000);
+}
+
+int main(int argc, char** argv)
+{ const uint32_t speeds[] = {100000, 400000, 1000000};
+  for(uint32_t hz : speeds)
+  { Bench b;
+    b.bus.riseTime_ns = argc > 1 ? atoi(argv[1]) : 0;
+    b.bus.stretch_ns = argc > 2 ? atoi(argv[2]) : 0;
+    b.bus.byteGap_ns = argc > 3 ? atoi(argv[3]) : 0;
+    b.bus.clock_Hz = hz;
+    b.gauge.begin(b.bus, b.clock);
+    b.gauge.designCap_mAh = 3000;
+    b.gauge.modelID = 0;
+    MAX17263I2CTiming t = max17263I2CTiming(hz, b.bus.riseTime_ns);
+    printf("%u kHz: SCL period %.3f us (%.1f kHz effective)%s\n", hz / 1000, t.bit_ns / 1000.0, 1e6 / t.bit_ns,
+           hz > 400000 ? ", beyond the 400kHz of the MAX17263" : "");
+    measure(b, "readReg16Bit", readReg);
+    measure(b, "writeReg16Bit", writeReg);
+    measure(b, "burst 7 words", burst);
+    measure(b, "readSnapshot()", snapshot);
+    measure(b, "readMeasurements(groupAll)", measurements);
+    measure(b, "initialize() after POR", initialize);
+    timeline(b.bus);
+  }
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+MIT License
+
+Throughput and bit-exactness check of the MAX17263Convert kernels: every kernel against the
+scalar one, and the scalar one against the driver getters and MAX17263::convert() for every
+word at several rSense values.
+Build:  g++ -O2 -std=c++17 -I. -I../.. convert_bench.cpp MAX17263Convert.cpp ../../MAX17263.cpp \
+            ../../MAX17263Clock.cpp Arduino.cpp -o convert_bench
+Usage:  ./convert_bench [words] [rSense]
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Convert.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Answers every read with the same word, so the getters convert it
+class WordBus : public MAX17263Bus
+{
+public:
+  uint16_t word = 0;
+  bool readRegs(byte address, byte reg, uint16_t* values, byte count)
+  { for(byte i=0; i<count; i++) values[i] = word;
+    return true;
+  }
+  bool writeRegs(byte address, byte reg, const uint16_t* values, byte count) { return true; }
+};
+
+// The batch conversion must give the same floats as the driver, for every word
+static bool checkDriver(float rSense)
+{ WordBus bus;
+  MAX17263 gauge;
+  gauge.begin(bus);
+  gauge.rSense = rSense;
+  gauge.designCap_mAh = 3000;
+  gauge.initialize(); // the multipliers, all registers read 0
+  MAX17263Scales s = max17263Scales(rSense);
+  MAX17263ConvertKernels k = max17263ConvertKernels(convertScalar);
+  struct { MAX17263Quantity quantity; bool isSigned; float lsb; float (MAX17263::*getter)(); } checks[] = {
+    {quantityCurrent, true, s.current_mA, &MAX17263::getCurrent}, {quantityVCell, false, s.vcell_V, &MAX17263::getVcell},
+    {quantityCapacity, false, s.capacity_mAh, &MAX17263::getCapacity_mAh}, {quantitySOC, false, s.soc_percent, &MAX17263::getSOC},
+    {quantityTemp, true, s.temp_C, &MAX17263::getTemp}};
+  std::vector<uint16_t> words(65536);
+  std::vector<float> batch(65536);
+  for(size_t w=0; w<65536; w++) words[w] = w;
+  uint32_t mismatches = 0;
+  for(auto& c : checks)
+  { (c.isSigned ? k.convertSigned : k.convertUnsigned)(words.data(), batch.data(), 65536, c.lsb);
+    for(size_t w=0; w<65536; w++)
+    { bus.word = w;
+      float getter = (gauge.*c.getter)(), convert = gauge.convert(c.quantity, w);
+      if(memcmp(&getter, &batch[w], sizeof(float)) || memcmp(&convert, &batch[w], sizeof(float)))
+      { if(!mismatches++) printf("rSense %g quantity %d word 0x%04zx: batch %.9g getter %.9g convert %.9g\n",
+                                  rSense, c.quantity, w, batch[w], getter, convert);
+      }
+    }
+  }
+  return !mismatches;
+}
+
+int main(int argc, char** argv)
+{ size_t n = argc > 1 ? strtoul(argv[1], 0, 0) : (1u << 22); // 8MB raw words
+  float rSense = argc > 2 ? strtof(argv[2], 0) : 0.01f;
+  MAX17263Scales s = max17263Scales(rSense);
+
+  std::vector<uint16_t> raw(n);
+  uint32_t seed = 1;
+  for(size_t i=0; i<n; i++) { seed = seed * 1664525u + 1013904223u; raw[i] = seed >> 16; }
+  for(size_t i=0; i<n && i<65536; i++) raw[i] = (uint16_t)i; // cover every possible word
+
+  std::vector<float> ref(n), out(n);
+  MAX17263ConvertKernels scalar = max17263ConvertKernels(convertScalar);
+  const MAX17263ConvertISA isas[] = {convertScalar, convertSSE41, convertAVX2, convertAVX512};
+  const float lsbs[] = {s.current_mA, s.vcell_V, s.capacity_mAh, s.soc_percent, s.temp_C};
+  bool ok = true;
+
+  printf("%zu words, rSense %g Ohm, best: %s\n", n, rSense, max17263ConvertKernels().name);
+  for(MAX17263ConvertISA isa : isas)
+  { if(!max17263ConvertSupported(isa)) continue;
+    MAX17263ConvertKernels k = max17263ConvertKernels(isa);
+    for(int sgn=0; sgn<2; sgn++)
+    { MAX17263ConvertFn fn = sgn ? k.convertSigned : k.convertUnsigned;
+      MAX17263ConvertFn rf = sgn ? scalar.convertSigned : scalar.convertUnsigned;
+      for(float lsb : lsbs)
+      { rf(raw.data(), ref.data(), n, lsb);
+        fn(raw.data(), out.data(), n, lsb);
+        if(memcmp(ref.data(), out.data(), n*sizeof(float)))
+        { printf("%s %s lsb %g: MISMATCH\n", k.name, sgn ? "signed" : "unsigned", lsb);
+          ok = false;
+        }
+      }
+      const int reps = 20;
+      auto t0 = std::chrono::steady_clock::now();
+      for(int r=0; r<reps; r++) fn(raw.data(), out.data(), n, lsbs[0]);
+      double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      printf("%-7s %-8s %8.2f GB/s raw in, %8.2f Gwords/s\n", k.name, sgn ? "signed" : "unsigned",
+             reps * n * sizeof(uint16_t) / sec / 1e9, reps * n / sec / 1e9);
+    }
+  }
+  printf(ok ? "all kernels bit-identical to scalar\n" : "kernel mismatch\n");
+
+  const float rSenses[] = {0.001f, 0.002f, 0.005f, 0.01f, 0.025f, 0.05f, 0.1f, rSense};
+  bool driverOK = true;
+  for(float r : rSenses) driverOK &= checkDriver(r);
+  printf(driverOK ? "scalar kernel bit-identical to the driver getters and convert()\n" : "driver mismatch\n");
+  return ok && driverOK ? 0 : 1;
+}
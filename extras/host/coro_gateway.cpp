@@ -0,0 +1,84 @@
+/*
+MIT License
+
+One thread drives GAUGES simulated gauges with the coroutine API: initialize, read SNAPSHOTS
+snapshots one second apart and save the learned parameters. The run time stays close to that
+of a single gauge, because the DNR and ModelCfg refresh waits yield instead of sleeping.
+Checked on the simulators: POR cleared and HibCfg restored; and for one more gauge whose FStat.DNR
+never clears: initialize() fails with faultDataNotReady, POR stays set, HibCfg is restored.
+
+Build:
+  g++ -O2 -std=c++20 -I. -I../.. coro_gateway.cpp MAX17263Coro.cpp ../../MAX17263.cpp ../../MAX17263Async.cpp \
+      ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp -o coro_gateway
+Usage:
+  coro_gateway [GAUGES] [SNAPSHOTS]
+*/
+
+#include "MAX17263Coro.h"
+#include "MAX17263Sim.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+struct Gateway
+{ MAX17263Sim sim;
+  MAX17263SimBus bus{sim};
+  MAX17263SimAsyncBackend backend{bus};
+  MAX17263AsyncBus async{backend};
+  std::unique_ptr<MAX17263CoroGauge> gauge;
+  MAX17263Snapshot snapshot;
+  MAX17263LearnedParams params;
+  int snapshots = 0;
+};
+
+static MAX17263Task<bool> run(MAX17263EventLoop& loop, Gateway& g, int snapshots)
+{ if(!co_await g.gauge->initialize()) co_return false;
+  for(int i = 0; i < snapshots; i++)
+  { if(i) co_await loop.sleep(1000);
+    if(!co_await g.gauge->readSnapshot(g.snapshot)) co_return false;
+    g.snapshots++;
+  }
+  co_return co_await g.gauge->saveLearnedParams(g.params);
+}
+
+int main(int argc, char** argv)
+{ int n = argc > 1 ? atoi(argv[1]) : 200;
+  int snapshots = argc > 2 ? atoi(argv[2]) : 3;
+  MAX17263EventLoop loop;
+  std::vector<std::unique_ptr<Gateway>> gateways;
+  std::vector<MAX17263Task<bool>> tasks;
+  for(int i = 0; i < n; i++)
+  { gateways.emplace_back(new Gateway);
+    Gateway& g = *gateways.back();
+    g.sim.battery_V = 3.6 + 0.5 * i / n;
+    g.gauge.reset(new MAX17263CoroGauge(loop, g.async));
+    loop.addBus(g.async);
+    tasks.push_back(run(loop, g, snapshots));
+  }
+  for(auto& t : tasks) loop.spawn(t);
+
+  uint32_t t0 = millis();
+  loop.run();
+  uint32_t elapsed = millis() - t0;
+
+  int passed = 0, reads = 0;
+  for(int i = 0; i < n; i++)
+  { passed += tasks[i].result() && !(gateways[i]->sim.regs[0x00] & 0x0002) && gateways[i]->sim.regs[0xBA] == 0x870C;
+    reads += gateways[i]->snapshots;
+  }
+
+  Gateway stuck; // a gauge that never gets ready
+  stuck.sim.dnrStuck = true;
+  stuck.gauge.reset(new MAX17263CoroGauge(loop, stuck.async));
+  loop.addBus(stuck.async);
+  MAX17263Task<bool> init = stuck.gauge->initialize();
+  loop.spawn(init);
+  loop.run();
+  bool failedClean = !init.result() && stuck.gauge->fault == faultDataNotReady && (stuck.sim.regs[0x00] & 0x0002) &&
+                     stuck.sim.regs[0xBA] == 0x870C;
+  printf("%d gauges on one thread: %d ok, %d snapshots, %u ms (one gauge alone: init %u + %d s)\n",
+         n, passed, reads, elapsed, gateways[0]->sim.dataReady_ms + gateways[0]->sim.modelRefresh_ms, snapshots - 1);
+  printf("gauge 0: SOC %.1f %%, FullCapNom 0x%04X\n", gateways[0]->snapshot.repSOC / 256.0, gateways[0]->params.fullCapNom);
+  printf("DNR never clears: %s\n", failedClean ? "fault, POR kept, HibCfg restored" : "ERROR");
+  return passed == n && failedClean ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Accelerated charge/discharge cycles: a MAX17263Scenario (MAX17263Battery.h) moves a cell
+through discharge, rest, CC-CV charge and rest, the driver runs the sketch of
+MAX17263_example.ino on MAX17263Sampler (Current every PERIOD ms, status every 2s, snapshot
+every 5.625s) and reads the simulated gauge through the bus. On a MAX17263VirtualClock the
+cycles run as fast as the CPU allows. The discharge ends at VEmpty, the charge at IchgTerm,
+both as the driver configured them.
+Reported per cycle and for the lifetime: driver CPU time (sampler.run(), including the
+simulated chip behind the bus), bus transactions and wire time, and the cycles per wall minute.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. cycle_sim.cpp MAX17263Battery.cpp ../../MAX17263.cpp ../../MAX17263Sampler.cpp \
+      ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp -o cycle_sim
+Usage:
+  cycle_sim [--cycles N] [--discharge mA] [--pulse HIGH,LOW,ON_ms,PERIOD_ms] [--charge mA]
+            [--rest min] [--capacity mAh] [--period ms]
+  default 1000 cycles, 1500mA discharge, 1500mA charge, 10 min rest, 3000mAh, Current every 175ms
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Battery.h"
+#include "MAX17263Sampler.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Device
+{ MAX17263VirtualClock clock;
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+  MAX17263Scenario scenario{sim};
+  float peak_mA = 0;
+  uint32_t samples = 0, snapshots = 0, initializations = 0;
+};
+
+static void trackCurrent(MAX17263Quantity quantity, float value, void *context)
+{ Device& d = *(Device*)context;
+  d.samples++;
+  if(-value > d.peak_mA) d.peak_mA = -value;
+}
+
+static void logSnapshot(const MAX17263Snapshot &snapshot, void *context)
+{ ((Device*)context)->snapshots++;
+}
+
+static void checkStatus(bool batteryPresent, bool initialized, void *context)
+{ ((Device*)context)->initializations += initialized;
+}
+
+int main(int argc, char** argv)
+{ uint32_t cycles = 1000, period_ms = 175;
+  float discharge_mA = 1500, charge_mA = 1500, rest_min = 10, capacity_mAh = 3000;
+  float pulse[4] = {0, 0, 0, 0};
+  for(int i = 1; i + 1 < argc; i += 2)
+  { const char* v = argv[i + 1];
+    if(!strcmp(argv[i], "--cycles")) cycles = atoi(v);
+    else if(!strcmp(argv[i], "--discharge")) discharge_mA = atof(v);
+    else if(!strcmp(argv[i], "--pulse")) sscanf(v, "%f,%f,%f,%f", &pulse[0], &pulse[1], &pulse[2], &pulse[3]);
+    else if(!strcmp(argv[i], "--charge")) charge_mA = atof(v);
+    else if(!strcmp(argv[i], "--rest")) rest_min = atof(v);
+    else if(!strcmp(argv[i], "--capacity")) capacity_mAh = atof(v);
+    else if(!strcmp(argv[i], "--period")) period_ms = atoi(v);
+    else { fprintf(stderr, "unknown option %s, see cycle_sim.cpp\n", argv[i]); return 2; }
+  }
+
+  Device d;
+  d.gauge.begin(d.bus, d.clock);
+  d.bus.sleepWireTime = true; // the wire time moves the virtual clock
+  d.gauge.rSense = 0.01;
+  d.gauge.designCap_mAh = capacity_mAh;
+  d.gauge.modelID = 0;
+  d.gauge.vEmpty = 3.3;
+  d.gauge.ichgTerm = 0x0640; // 250mA at 10mOhm
+  MAX17263Scenario& s = d.scenario;
+  s.cell.capacity_mAh = capacity_mAh;
+  s.cell.soc = 1;
+  MAX17263LoadStep discharge = {loadConstant, -discharge_mA};
+  if(pulse[3] > 0)
+  { discharge.kind = loadPulsed;
+    discharge.current_mA = -pulse[0];
+    discharge.low_mA = -pulse[1];
+    discharge.on_ms = pulse[2];
+    discharge.period_ms = pulse[3];
+  }
+  MAX17263LoadStep rest = {loadRest, 0};
+  rest.duration_ms = rest_min * 60000;
+  MAX17263LoadStep charge = {loadCharge, charge_mA};
+  s.steps = {discharge, rest, charge, rest};
+
+  MAX17263Sampler sampler(d.gauge, d.clock);
+  sampler.every(period_ms, quantityCurrent, trackCurrent, &d);
+  sampler.everyStatus(2000, checkStatus, &d);
+  sampler.everySnapshot(5625, logSnapshot, &d);
+
+  std::chrono::steady_clock::duration driver{};
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  uint64_t start_us = d.clock.now_us, scenario_ms = d.clock.now_us / 1000;
+  while(s.cycles < cycles)
+  { uint64_t now_ms = d.clock.now_us / 1000; // the cell follows the clock, also the time on the bus
+    s.advance(now_ms - scenario_ms);
+    scenario_ms = now_ms;
+    std::chrono::steady_clock::time_point r = std::chrono::steady_clock::now();
+    uint32_t wait_ms = sampler.run();
+    driver += std::chrono::steady_clock::now() - r;
+    d.clock.advance_ms(wait_ms ? wait_ms : 1);
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  double driver_s = std::chrono::duration<double>(driver).count();
+  double virtual_h = (d.clock.now_us - start_us) / 3.6e9;
+
+  printf("%u cycles, %.0f virtual days in %.2f s wall time, %.0f cycles per minute\n",
+         s.cycles, virtual_h / 24, wall_s, s.cycles / wall_s * 60);
+  printf("discharge ended at VEmpty %.2fV %u times, charge terminated at IchgTerm %.0fmA %u times, time limits %u\n",
+         s.vEmpty(), s.emptyStops, s.ichgTerm_mA(), s.chargeTerminations, s.timeLimits);
+  printf("%.0f Ah discharged, gauge Cycles %.2f (16 bit, wraps at 10485.6), peak current %.0fmA\n",
+         s.throughput_mAh / 1000, d.sim.regs[0x17] * MAX17263RegCycles::lsb(), d.peak_mA);
+  printf("samples %u, snapshots %u, initialize() %u, read errors %u\n",
+         d.samples, d.snapshots, d.initializations, d.gauge.busStats.readErrors);
+  printf("lifetime:  driver CPU %.3f s, %u bus transactions, %.1f s wire time\n",
+         driver_s, d.bus.transactions, d.bus.wireTime_us / 1e6);
+  printf("per cycle: driver CPU %.1f us, %.0f bus transactions, %.2f s wire time, %.2f h\n",
+         driver_s / s.cycles * 1e6, (double)d.bus.transactions / s.cycles, d.bus.wireTime_us / 1e6 / s.cycles,
+         virtual_h / s.cycles);
+  return s.emptyStops == s.cycles && s.chargeTerminations == s.cycles ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Captures, prints and compares full register dumps of MAX17263::dumpAll().
+A dump is the 512 byte blob of dumpAll(), 256 words little endian, index = register address.
+Register names are taken from the "const byte regXxx = 0x.." lines of MAX17263.h, so new
+registers in the driver show up without changing this tool.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. dump_tool.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp \
+      MAX17263LinuxI2C.cpp -o dump_tool
+Usage:
+  dump_tool read FILE [/dev/i2c-N]   dump a gauge, the simulator without device, prints the dump time
+  dump_tool show FILE                registers that are not 0
+  dump_tool diff FILE1 FILE2         registers that differ, with the changed bits
+Options:
+  --header PATH                      MAX17263.h for the register names, default ../../MAX17263.h
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sim.h"
+#include "MAX17263LinuxI2C.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+static std::string names[256];
+
+static void loadNames(const char* header)
+{ std::ifstream in(header);
+  if(!in) { fprintf(stderr, "cannot read %s, no register names\n", header); return; }
+  std::regex declaration("const byte reg(\\w+)\\s*=\\s*0x([0-9A-Fa-f]{2})");
+  std::string line;
+  while(std::getline(in, line))
+  { std::smatch m;
+    if(!std::regex_search(line, m, declaration)) continue;
+    std::string& name = names[std::stoi(m[2].str(), 0, 16)];
+    if(name.empty()) name = m[1].str();
+  }
+}
+
+static bool load(const char* path, uint16_t* regs)
+{ FILE* f = fopen(path, "rb");
+  byte blob[512];
+  bool ok = f && fread(blob, 1, sizeof(blob), f) == sizeof(blob);
+  if(f) fclose(f);
+  if(!ok) { fprintf(stderr, "cannot read %s\n", path); return false; }
+  for(int i = 0; i < 256; i++) regs[i] = blob[2 * i] | blob[2 * i + 1] << 8;
+  return true;
+}
+
+static bool save(const char* path, const uint16_t* regs)
+{ byte blob[512];
+  for(int i = 0; i < 256; i++)
+  { blob[2 * i] = regs[i] & 0xFF;
+    blob[2 * i + 1] = regs[i] >> 8;
+  }
+  FILE* f = fopen(path, "wb");
+  bool ok = f && fwrite(blob, 1, sizeof(blob), f) == sizeof(blob);
+  if(f) ok &= fclose(f) == 0;
+  return ok;
+}
+
+static void printBits(uint16_t value)
+{ for(int bit = 15; bit >= 0; bit--) printf("%c%s", value & 1 << bit ? '1' : '0', bit % 4 || !bit ? "" : ".");
+}
+
+static int read(const char* path, const char* device)
+{ MAX17263Sim sim;
+  MAX17263SimBus simBus(sim);
+  std::optional<MAX17263LinuxI2C> adapter;
+  MAX17263Bus* bus = &simBus;
+  if(device)
+  { adapter.emplace(device);
+    if(!adapter->isOpen()) { fprintf(stderr, "cannot open %s\n", device); return 1; }
+    bus = &*adapter;
+  }
+  MAX17263 gauge;
+  gauge.begin(*bus);
+  uint16_t regs[256];
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  bool ok = gauge.dumpAll(regs);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  if(!ok) { fprintf(stderr, "bus error\n"); return 1; }
+  if(!save(path, regs)) { fprintf(stderr, "cannot write %s\n", path); return 1; }
+  if(device) printf("%s: dump in %.2f ms\n", path, ms);
+  else printf("%s: dump in %.2f ms, wire time at 400kHz %.2f ms\n", path, ms, simBus.wireTime_us / 1000.0);
+  return 0;
+}
+
+static int show(const char* path)
+{ uint16_t regs[256];
+  if(!load(path, regs)) return 1;
+  for(int reg = 0; reg < 256; reg++)
+  { if(!regs[reg]) continue;
+    printf("0x%02X %-12s 0x%04X  ", reg, names[reg].c_str(), regs[reg]);
+    printBits(regs[reg]);
+    printf("\n");
+  }
+  return 0;
+}
+
+static int diff(const char* path1, const char* path2)
+{ uint16_t a[256], b[256];
+  if(!load(path1, a) || !load(path2, b)) return 1;
+  int differences = 0;
+  for(int reg = 0; reg < 256; reg++)
+  { if(a[reg] == b[reg]) continue;
+    printf("0x%02X %-12s 0x%04X -> 0x%04X  changed bits ", reg, names[reg].c_str(), a[reg], b[reg]);
+    printBits(a[reg] ^ b[reg]);
+    printf("\n");
+    differences++;
+  }
+  printf("%d registers differ\n", differences);
+  return differences != 0;
+}
+
+int main(int argc, char** argv)
+{ const char* header = "../../MAX17263.h";
+  std::vector<const char*> args;
+  for(int i = 1; i < argc; i++)
+  { if(!strcmp(argv[i], "--header") && i + 1 < argc) header = argv[++i];
+    else args.push_back(argv[i]);
+  }
+  loadNames(header);
+  if(args.size() >= 2 && !strcmp(args[0], "read")) return read(args[1], args.size() > 2 ? args[2] : 0);
+  if(args.size() >= 2 && !strcmp(args[0], "show")) return show(args[1]);
+  if(args.size() >= 3 && !strcmp(args[0], "diff")) return diff(args[1], args[2]);
+  fprintf(stderr, "usage: dump_tool read|show|diff ..., see dump_tool.cpp\n");
+  return 2;
+}
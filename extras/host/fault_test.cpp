@@ -0,0 +1,166 @@
+/*
+MIT License
+
+Fault injection on the simulator: how long the driver takes to notice a fault and to deliver
+valid data again, and how many bus transactions it wastes on the way. The sketch is that of
+MAX17263_example.ino on MAX17263Sampler: Current every 175ms, a snapshot every second, the
+status check every 2s (initialize() after a POR, with backoff when it fails), on a virtual clock.
+
+Per fault, all times in ms from the injection:
+  detect    first sign in the driver: a bus error after all retries, battery missing, or a POR
+            seen by the status check (a fault masked by the retries is never detected)
+  recover   first valid reading after the fault is gone (ground truth of the simulator: bus
+            free, battery present, POR handled, DNR clear, configuration in place)
+  blocked   longest sampler.run(), the time the loop could not do anything else
+  wasted    transactions beyond the normal rate of the sketch until the recovery, failed ones
+            are counted as well
+Faults with a duration end by themselves (e.g. the battery is inserted again), the others
+must be repaired by the driver. A fault of the last initialize() left at the end fails the test,
+POR must stay set after a failed initialize() so that the status check retries it.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. fault_test.cpp ../../MAX17263.cpp ../../MAX17263Sampler.cpp ../../MAX17263Clock.cpp \
+      Arduino.cpp MAX17263Sim.cpp -o fault_test
+Usage:
+  fault_test [CLOCK_Hz]   default 400000
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sampler.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <cstdio>
+#include <cstdlib>
+
+struct Rig
+{ MAX17263VirtualClock clock;
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+  MAX17263Sampler sampler{gauge, clock};
+  uint32_t end_ms = 0; // the fault is gone
+  int64_t detect_ms = -1, recover_ms = -1;
+  uint32_t inject_ms = 0;
+  bool injected = false;
+
+  bool healthy() // ground truth
+  { return !bus.sdaStuckLow && !bus.nakCount && sim.batteryPresent && !(sim.regs[0x00] & 0x0002) &&
+           !(sim.regs[0x3D] & 0x0001) && sim.regs[0x18] == (uint16_t)(gauge.designCap_mAh * gauge.rSense / 5.0e-3);
+  }
+  void detected(uint32_t now)
+  { if(injected && detect_ms < 0) detect_ms = now - inject_ms;
+  }
+  void valid()
+  { uint32_t now = clock.millis();
+    if(injected && recover_ms < 0 && (int32_t)(now - end_ms) >= 0 && healthy()) recover_ms = now - inject_ms;
+  }
+};
+
+static void onSample(MAX17263Quantity quantity, float value, void *context)
+{ ((Rig*)context)->valid();
+}
+
+static void onSnapshot(const MAX17263Snapshot &snapshot, void *context)
+{ ((Rig*)context)->valid();
+}
+
+static void onStatus(bool batteryPresent, bool initialized, void *context)
+{ Rig& r = *(Rig*)context;
+  bool initializeRan = initialized || r.gauge.fault;
+  if(!batteryPresent || initializeRan) r.detected(r.clock.millis() - (initializeRan ? r.gauge.initialize_ms : 0));
+}
+
+struct Fault
+{ const char* name;
+  uint32_t duration_ms; // 0: until the driver repairs it
+  void (*inject)(Rig& r);
+  void (*clear)(Rig& r);
+};
+
+static void none(Rig& r) {}
+static const Fault faults[] = {
+  {"NAK x2",                   0, [](Rig& r) { r.bus.nakCount = 2; }, none},
+  {"NAK x20",                  0, [](Rig& r) { r.bus.nakCount = 20; }, none},
+  {"NAK for 2s",            2000, [](Rig& r) { r.bus.nakCount = 0xFFFFFFFF; }, [](Rig& r) { r.bus.nakCount = 0; }},
+  {"short read x3",            0, [](Rig& r) { r.bus.shortReadCount = 3; }, none},
+  {"SDA stuck low",            0, [](Rig& r) { r.bus.sdaStuckLow = true; }, none},
+  {"SDA stuck low 5s",      5000, [](Rig& r) { r.bus.sdaStuckLow = true; r.bus.sdaReleaseClocks = 0; },
+                                  [](Rig& r) { r.bus.sdaStuckLow = false; }},
+  {"spurious POR",             0, [](Rig& r) { r.sim.powerOnReset(); }, none},
+  {"brown-out",                0, [](Rig& r) { r.sim.warmReset(); }, none},
+  {"battery removed 3s",    3000, [](Rig& r) { r.sim.batteryPresent = false; }, [](Rig& r) { r.sim.batteryPresent = true; }},
+  {"DNR never clears 10s", 10000, [](Rig& r) { r.sim.dnrStuck = true; r.sim.powerOnReset(); }, [](Rig& r) { r.sim.dnrStuck = false; }},
+  {"refresh stuck 10s",    10000, [](Rig& r) { r.sim.modelRefresh_ms = 60000; r.sim.powerOnReset(); }, // POR must stay set
+                                  [](Rig& r) { r.sim.modelRefresh_ms = 300; }},
+};
+
+static bool run(const Fault& f, uint32_t clock_Hz)
+{ Rig r;
+  r.bus.clock_Hz = clock_Hz;
+  r.gauge.begin(r.bus, r.clock);
+  r.gauge.rSense = 0.01;
+  r.gauge.designCap_mAh = 3000;
+  r.gauge.modelID = 0;
+  r.gauge.vEmpty = 3.3;
+  r.gauge.ichgTerm = 0x0640;
+  r.sampler.every(175, quantityCurrent, onSample, &r);
+  r.sampler.everySnapshot(1000, onSnapshot, &r);
+  r.sampler.everyStatus(2000, onStatus, &r);
+
+  const uint32_t settle_ms = 10000, baseline_ms = 20737, limit_ms = 120000; // injected off the task grid
+  uint32_t baselineStart = 0, baseline = 0, transactions = 0, failed = 0, retries = 0, inits = 0, blocked = 0;
+  bool settled = false, cleared = false;
+  while(true)
+  { uint32_t now = r.clock.millis();
+    if(!settled && now >= settle_ms)
+    { settled = true;
+      baselineStart = now;
+      baseline = r.bus.transactions;
+    }
+    if(!r.injected && now >= settle_ms + baseline_ms)
+    { baseline = r.bus.transactions - baseline; // normal traffic of the sketch
+      r.injected = true;
+      r.inject_ms = now;
+      r.end_ms = now + f.duration_ms;
+      transactions = r.bus.transactions;
+      failed = r.bus.failed;
+      retries = r.gauge.busStats.retries;
+      inits = r.sampler.initFailures;
+      f.inject(r);
+    }
+    if(r.injected && !cleared && (int32_t)(now - r.end_ms) >= 0)
+    { f.clear(r);
+      cleared = true;
+    }
+    uint32_t errors = r.gauge.busStats.readErrors + r.gauge.busStats.writeErrors;
+    uint32_t wait = r.sampler.run();
+    uint32_t after = r.clock.millis();
+    if(r.gauge.busStats.readErrors + r.gauge.busStats.writeErrors != errors) r.detected(now);
+    if(r.injected && after - now > blocked) blocked = after - now;
+    if(r.recover_ms >= 0 || (r.injected && after - r.inject_ms > limit_ms)) break;
+    if(r.injected && !cleared && (int32_t)(r.end_ms - after) > 0 && r.end_ms - after < wait) wait = r.end_ms - after;
+    r.clock.advance_ms(wait ? wait : 1);
+  }
+  uint32_t elapsed = r.clock.millis() - r.inject_ms;
+  double rate = (double)baseline / (r.inject_ms - baselineStart); // transactions per ms of the sketch
+  long wasted = (long)(r.bus.transactions - transactions) - (long)(rate * elapsed + 0.5);
+  char detect[24], recover[24];
+  if(r.detect_ms >= 0) snprintf(detect, sizeof detect, "%lld", (long long)r.detect_ms);
+  else snprintf(detect, sizeof detect, "masked");
+  if(r.recover_ms >= 0) snprintf(recover, sizeof recover, "%lld", (long long)r.recover_ms);
+  else snprintf(recover, sizeof recover, "never");
+  printf("%-22s %7u %7s %8s %8u %7ld %7u %7u %7u %7u  %s\n", f.name, f.duration_ms, detect, recover, blocked,
+         wasted < 0 ? 0 : wasted, r.bus.failed - failed, r.gauge.busStats.retries - retries, r.bus.clears,
+         r.sampler.initFailures - inits, r.gauge.fault == faultNone ? "" : "fault left");
+  return r.recover_ms >= 0 && r.gauge.fault == faultNone; // a fault left means initialize() was not retried
+}
+
+int main(int argc, char** argv)
+{ uint32_t clock_Hz = argc > 1 ? atoi(argv[1]) : 400000;
+  printf("%u kHz, times in ms from the injection\n", clock_Hz / 1000);
+  printf("%-22s %7s %7s %8s %8s %7s %7s %7s %7s %7s\n", "fault", "length", "detect", "recover", "blocked",
+         "wasted", "failed", "retries", "clears", "init fails");
+  bool ok = true;
+  for(const Fault& f : faults) ok &= run(f, clock_Hz);
+  return ok ? 0 : 1;
+}
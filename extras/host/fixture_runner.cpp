@@ -0,0 +1,209 @@
+/*
+MIT License
+
+End-of-line test fixture runner: tests the gauges of a panel concurrently, one worker thread
+per I2C bus, the gauges of a bus one after the other through its multiplexer channels.
+Every board gets the driver sequence:
+  config programming  initialize() with the battery parameters below, DesignCap read back
+  production test     productionTest() Quickstart T1..T3, with the step durations
+  calibration check   VCell against the fixture supply voltage, Current against zero load
+One result line per board is streamed to the log.
+
+Build:
+  g++ -O2 -std=c++17 -pthread -I. -I../.. fixture_runner.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp Arduino.cpp \
+      MAX17263Sim.cpp MAX17263LinuxI2C.cpp -o fixture_runner
+Usage:
+  fixture_runner [options] /dev/i2c-1 /dev/i2c-2:0x70:0-7 ...   hardware, optional mux address and channels
+  fixture_runner [options] --sim BUSES CHANNELS                 simulated gauges
+  fixture_runner [options] --scaling BUSES CHANNELS             simulated, throughput for 1..BUSES buses
+Options:
+  --log FILE        result log, default stdout
+  --boards N        simulation: panels tested per run, default 1
+  --vcell V         fixture supply voltage, default 3.9
+  --vtol V          VCell tolerance, default 0.05
+  --itol mA         Current offset tolerance, default 10
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sim.h"
+#include "MAX17263LinuxI2C.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FixtureSettings
+{ float vcell_V = 3.9, vcellTolerance_V = 0.05, currentTolerance_mA = 10;
+  int boards = 1;
+};
+
+struct BusSpec
+{ std::string device;
+  int muxAddress = -1; // no mux
+  std::vector<byte> channels;
+};
+
+static FixtureSettings settings;
+static FILE* logFile = stdout;
+static std::mutex logMutex;
+
+static void initBatteryParameters(MAX17263& gauge)
+{ gauge.rSense = 0.01;
+  gauge.designCap_mAh = 3000;
+  gauge.r100 = 0;
+  gauge.vChg = 0;
+  gauge.modelID = 0;
+  gauge.ichgTerm = 0x0640;
+  gauge.vEmpty = 3.3;
+}
+
+// Test one board, returns pass
+static bool testBoard(MAX17263Bus& bus, int busIndex, int channel, int board)
+{ uint32_t t0 = millis();
+  MAX17263 gauge;
+  gauge.begin(bus);
+  initBatteryParameters(gauge);
+  const char* failure = "";
+  float vcell = NAN, current = NAN;
+  uint32_t config_ms = 0;
+
+  if(!gauge.batteryPresent()) failure = "no gauge or battery";
+  else
+  { gauge.initialize(); // config programming
+    config_ms = millis() - t0;
+    uint16_t designCap = 0;
+    bus.readRegs(0x36, gauge.regDesignCap, &designCap, 1);
+    if(abs(designCap - (int32_t)(gauge.designCap_mAh * gauge.rSense / 5.0e-3)) > 1) failure = "DesignCap readback"; // 5uVh/rSense LSB
+    else if(!gauge.productionTest()) failure = "production test";
+    else
+    { vcell = gauge.getVcell();
+      current = gauge.getCurrent();
+      if(fabs(vcell - settings.vcell_V) > settings.vcellTolerance_V) failure = "VCell calibration";
+      else if(fabs(current) > settings.currentTolerance_mA) failure = "Current offset";
+    }
+  }
+
+  const MAX17263ProductionTestResult& r = gauge.productionTestResult;
+  std::lock_guard<std::mutex> lock(logMutex);
+  fprintf(logFile, "bus %d ch %d board %d %s%s%s config %u ms T1 %u T2 %u T3 %u ms SOC %.1f %% VCell %.3f V Current %.1f mA total %u ms\n",
+          busIndex, channel, board, *failure ? "FAIL " : "PASS", failure, *failure ? "," : "",
+          config_ms, r.stepDuration_ms[0], r.stepDuration_ms[1], r.stepDuration_ms[2], r.repSOC,
+          vcell, current, millis() - t0);
+  fflush(logFile);
+  return !*failure;
+}
+
+static void hardwareWorker(const BusSpec* spec, int busIndex, int* passed)
+{ MAX17263LinuxI2C adapter(spec->device.c_str());
+  if(!adapter.isOpen())
+  { std::lock_guard<std::mutex> lock(logMutex);
+    fprintf(logFile, "bus %d: cannot open %s\n", busIndex, spec->device.c_str());
+    return;
+  }
+  if(spec->muxAddress < 0) *passed += testBoard(adapter, busIndex, 0, 0);
+  else for(byte ch : spec->channels)
+  { MAX17263MuxChannel bus(adapter, spec->muxAddress, ch);
+    *passed += testBoard(bus, busIndex, ch, 0);
+  }
+}
+
+static void simWorker(int busIndex, int channels, int* passed)
+{ for(int board = 0; board < settings.boards; board++)
+    for(int ch = 0; ch < channels; ch++)
+    { MAX17263Sim sim; // new board, power on reset
+      sim.rSense = 0.01;
+      sim.battery_V = settings.vcell_V;
+      MAX17263SimBus bus(sim);
+      *passed += testBoard(bus, busIndex, ch, board);
+    }
+}
+
+// Run all workers in parallel, returns the number of boards tested per minute
+static double runSim(int buses, int channels, int* passed)
+{ std::vector<std::thread> workers;
+  std::vector<int> pass(buses, 0);
+  auto t0 = std::chrono::steady_clock::now();
+  for(int b = 0; b < buses; b++) workers.emplace_back(simWorker, b, channels, &pass[b]);
+  for(auto& w : workers) w.join();
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  *passed = 0;
+  for(int p : pass) *passed += p;
+  return buses * channels * settings.boards / sec * 60;
+}
+
+static bool parseBusSpec(const char* arg, BusSpec& spec)
+{ std::string s(arg);
+  size_t c1 = s.find(':');
+  spec.device = s.substr(0, c1);
+  if(c1 == std::string::npos) return true;
+  size_t c2 = s.find(':', c1 + 1);
+  if(c2 == std::string::npos) return false;
+  spec.muxAddress = strtol(s.c_str() + c1 + 1, 0, 0);
+  int first, last;
+  if(sscanf(s.c_str() + c2 + 1, "%d-%d", &first, &last) == 2)
+    for(int ch = first; ch <= last && ch < 8; ch++) spec.channels.push_back(ch);
+  else spec.channels.push_back(atoi(s.c_str() + c2 + 1) & 7);
+  return true;
+}
+
+int main(int argc, char** argv)
+{ std::vector<BusSpec> specs;
+  int simBuses = 0, simChannels = 0;
+  bool scaling = false;
+  for(int i = 1; i < argc; i++)
+  { if(!strcmp(argv[i], "--log") && i + 1 < argc)
+    { logFile = fopen(argv[++i], "a");
+      if(!logFile) { perror(argv[i]); return 2; }
+    }
+    else if(!strcmp(argv[i], "--boards") && i + 1 < argc) settings.boards = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--vcell") && i + 1 < argc) settings.vcell_V = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--vtol") && i + 1 < argc) settings.vcellTolerance_V = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--itol") && i + 1 < argc) settings.currentTolerance_mA = atof(argv[++i]);
+    else if((!strcmp(argv[i], "--sim") || !strcmp(argv[i], "--scaling")) && i + 2 < argc)
+    { scaling = !strcmp(argv[i], "--scaling");
+      simBuses = atoi(argv[++i]);
+      simChannels = atoi(argv[++i]);
+    }
+    else
+    { BusSpec spec;
+      if(argv[i][0] == '-' || !parseBusSpec(argv[i], spec))
+      { fprintf(stderr, "usage: see the top of fixture_runner.cpp\n");
+        return 2;
+      }
+      specs.push_back(spec);
+    }
+  }
+
+  int passed = 0, total = 0;
+  if(simBuses > 0)
+  { std::vector<int> busCounts;
+    for(int b = 1; scaling && b < simBuses; b *= 2) busCounts.push_back(b);
+    busCounts.push_back(simBuses);
+    for(int buses : busCounts)
+    { double perMinute = runSim(buses, simChannels, &passed);
+      total = buses * simChannels * settings.boards;
+      fprintf(stderr, "%d buses x %d channels: %d/%d passed, %.1f boards/minute\n",
+              buses, simChannels, passed, total, perMinute);
+    }
+  }
+  else
+  { std::vector<std::thread> workers;
+    std::vector<int> pass(specs.size(), 0);
+    auto t0 = std::chrono::steady_clock::now();
+    for(size_t b = 0; b < specs.size(); b++)
+    { workers.emplace_back(hardwareWorker, &specs[b], (int)b, &pass[b]);
+      total += specs[b].muxAddress < 0 ? 1 : specs[b].channels.size();
+    }
+    for(auto& w : workers) w.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for(int p : pass) passed += p;
+    fprintf(stderr, "%d/%d passed in %.2f s\n", passed, total, sec);
+  }
+  return passed == total ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/*
+MIT License
+
+Load test of a gateway ingest path with a farm of virtual gauges. Every gauge is a MAX17263Sim
+running the real driver (MAX17263.cpp) on its own MAX17263VirtualClock, so it needs no real
+time: initialize() once, then every round the clock of the gauge moves PERIOD ms ahead and
+readSnapshot() produces a telemetry record. The gauges are split over WORKERS threads, each
+sends its records in batches to the decoder thread as fast as it can (line rate), the decoder
+converts the raw words with the MAX17263Convert kernels, as the host side of a gateway does.
+Bounded queue: when the decoder falls behind, the workers wait, like on a full socket.
+
+Reported per gauge count: records per second through decode, and the latency of a record from
+readSnapshot() to decoded (p50, p99, p99.9, max), which includes the batching and queueing.
+
+Build:
+  g++ -O2 -std=c++17 -pthread -I. -I../.. gauge_farm.cpp MAX17263Convert.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp \
+      Arduino.cpp MAX17263Sim.cpp -o gauge_farm
+Usage:
+  gauge_farm [GAUGES,GAUGES,...] [ROUNDS] [PERIOD_ms] [WORKERS] [BATCH]
+  default 1000,10000,40000 20 1000, workers = cores - 1 (at least 1), batch 256 records
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Convert.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct FarmGauge
+{ MAX17263VirtualClock clock;
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+};
+
+struct Record
+{ uint32_t gauge;
+  MAX17263Snapshot snapshot;
+  Clock::time_point read; // host time of readSnapshot(), for the latency
+};
+
+// Batches from the workers to the decoder, at most depth batches in flight
+class Ingest
+{
+public:
+  Ingest(size_t depth) : depth(depth) {}
+  void push(std::vector<Record>& batch)
+  { std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [&] { return queue.size() < depth; });
+    queue.emplace_back(std::move(batch));
+    batch.clear();
+    notEmpty.notify_one();
+  }
+  bool pop(std::vector<Record>& batch) // false when closed and empty
+  { std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [&] { return !queue.empty() || closed; });
+    if(queue.empty()) return false;
+    batch = std::move(queue.front());
+    queue.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+  void close()
+  { std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notEmpty.notify_all();
+  }
+
+private:
+  size_t depth;
+  bool closed = false;
+  std::deque<std::vector<Record>> queue;
+  std::mutex mutex;
+  std::condition_variable notEmpty, notFull;
+};
+
+// Host side: column split of the raw words, batch conversion, latency of every record
+struct Decoder
+{ MAX17263Scales scales = max17263Scales(0.01);
+  std::vector<uint16_t> current, vCell, repSOC, temp, repCap;
+  std::vector<float> out;
+  std::vector<uint32_t> latency_us;
+  uint64_t records = 0, outOfRange = 0;
+  double busy_s = 0;
+
+  void decode(const std::vector<Record>& batch)
+  { Clock::time_point t0 = Clock::now();
+    size_t n = batch.size();
+    current.resize(n); vCell.resize(n); repSOC.resize(n); temp.resize(n); repCap.resize(n); out.resize(5 * n);
+    for(size_t i = 0; i < n; i++)
+    { const MAX17263Snapshot& s = batch[i].snapshot;
+      current[i] = s.current; vCell[i] = s.vCell; repSOC[i] = s.repSOC; temp[i] = s.temp; repCap[i] = s.repCap;
+    }
+    float *mA = &out[0], *V = mA + n, *percent = V + n, *C = percent + n, *mAh = C + n;
+    max17263ConvertCurrent(current.data(), mA, n, scales);
+    max17263ConvertVCell(vCell.data(), V, n, scales);
+    max17263ConvertSOC(repSOC.data(), percent, n, scales);
+    max17263ConvertTemp(temp.data(), C, n, scales);
+    max17263ConvertCapacity(repCap.data(), mAh, n, scales);
+    Clock::time_point done = Clock::now();
+    for(size_t i = 0; i < n; i++)
+    { outOfRange += V[i] < 2.5 || V[i] > 4.5 || percent[i] > 100 || C[i] < -40 || C[i] > 85;
+      latency_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(done - batch[i].read).count());
+    }
+    records += n;
+    busy_s += std::chrono::duration<double>(done - t0).count();
+  }
+};
+
+// The gauges of one worker: a round is PERIOD ms of virtual time on every clock and one snapshot
+static void work(std::vector<std::unique_ptr<FarmGauge>>& gauges, size_t first, size_t last,
+                 int rounds, uint32_t period_ms, size_t batchSize, Ingest& ingest, uint32_t& errors)
+{ std::vector<Record> batch;
+  batch.reserve(batchSize);
+  for(int r = 0; r < rounds; r++)
+    for(size_t i = first; i < last; i++)
+    { FarmGauge& g = *gauges[i];
+      g.clock.advance_ms(period_ms);
+      Record record;
+      record.gauge = i;
+      if(!g.gauge.readSnapshot(record.snapshot)) { errors++; continue; }
+      record.read = Clock::now();
+      batch.push_back(record);
+      if(batch.size() >= batchSize) ingest.push(batch);
+    }
+  if(!batch.empty()) ingest.push(batch);
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{ return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+static bool runFarm(size_t n, int rounds, uint32_t period_ms, unsigned workers, size_t batchSize)
+{ std::vector<std::unique_ptr<FarmGauge>> gauges;
+  gauges.reserve(n);
+  for(size_t i = 0; i < n; i++)
+  { gauges.emplace_back(new FarmGauge);
+    FarmGauge& g = *gauges.back();
+    g.sim.battery_V = 3.5 + 0.6 * i / n;
+    g.sim.current_mA = -100.0 * (i % 20);
+    g.clock.now_us = (uint64_t)i * 7919; // not in step, like real gauges
+    g.gauge.begin(g.bus, g.clock);
+    g.gauge.rSense = 0.01;
+    g.gauge.designCap_mAh = 3000;
+    g.gauge.modelID = 0;
+  }
+
+  // initialize() every gauge, not timed: DNR and ModelCfg waits are virtual
+  Clock::time_point t0 = Clock::now();
+  { std::vector<std::thread> threads;
+    for(unsigned w = 0; w < workers; w++)
+      threads.emplace_back([&, w] { for(size_t i = n * w / workers; i < n * (w + 1) / workers; i++) gauges[i]->gauge.initialize(); });
+    for(auto& t : threads) t.join();
+  }
+  double init_s = std::chrono::duration<double>(Clock::now() - t0).count();
+  uint64_t transactions = 0;
+  for(auto& g : gauges) transactions -= g->bus.transactions; // only the telemetry counts below
+
+  Ingest ingest(4 * workers);
+  Decoder decoder;
+  decoder.latency_us.reserve(n * rounds);
+  std::vector<uint32_t> errors(workers);
+  t0 = Clock::now();
+  std::thread decode([&] { std::vector<Record> batch; while(ingest.pop(batch)) decoder.decode(batch); });
+  std::vector<std::thread> threads;
+  for(unsigned w = 0; w < workers; w++)
+    threads.emplace_back(work, std::ref(gauges), n * w / workers, n * (w + 1) / workers, rounds, period_ms, batchSize,
+                         std::ref(ingest), std::ref(errors[w]));
+  for(auto& t : threads) t.join();
+  ingest.close();
+  decode.join();
+  double wall_s = std::chrono::duration<double>(Clock::now() - t0).count();
+
+  uint32_t readErrors = 0;
+  for(uint32_t e : errors) readErrors += e;
+  for(auto& g : gauges) transactions += g->bus.transactions;
+  std::sort(decoder.latency_us.begin(), decoder.latency_us.end());
+  printf("%6zu gauges %4.1f s init, %8llu records %6.2f s, %9.0f records/s, %5.1f%% decoder busy, "
+         "latency p50 %6u p99 %6u p99.9 %6u max %6u us, %.1f bus transactions/record, errors %u, out of range %llu\n",
+         n, init_s, (unsigned long long)decoder.records, wall_s, decoder.records / wall_s, 100 * decoder.busy_s / wall_s,
+         percentile(decoder.latency_us, 0.5), percentile(decoder.latency_us, 0.99), percentile(decoder.latency_us, 0.999),
+         decoder.latency_us.empty() ? 0 : decoder.latency_us.back(), (double)transactions / (n * rounds), readErrors,
+         (unsigned long long)decoder.outOfRange);
+  return decoder.records == (uint64_t)n * rounds && !readErrors && !decoder.outOfRange;
+}
+
+int main(int argc, char** argv)
+{ std::vector<size_t> counts = {1000, 10000, 40000};
+  if(argc > 1)
+  { counts.clear();
+    for(char* p = argv[1]; *p; p += *p == ',') counts.push_back(strtoul(p, &p, 10));
+  }
+  int rounds = argc > 2 ? atoi(argv[2]) : 20;
+  uint32_t period_ms = argc > 3 ? atoi(argv[3]) : 1000;
+  unsigned cores = std::thread::hardware_concurrency();
+  unsigned workers = argc > 4 ? atoi(argv[4]) : cores > 1 ? cores - 1 : 1;
+  size_t batch = argc > 5 ? atoi(argv[5]) : 256;
+  printf("%u workers, 1 decoder (%s kernels), %d rounds of %u ms virtual time, batches of %zu records\n",
+         workers, max17263ConvertKernels().name, rounds, period_ms, batch);
+  bool ok = true;
+  for(size_t n : counts) ok &= runFarm(n, rounds, period_ms, workers, batch);
+  return ok ? 0 : 1;
+}
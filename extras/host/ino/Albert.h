@@ -0,0 +1,50 @@
+/*
+MIT License
+
+Host stand-in for the Albert library as far as Arduino-MAX17263_Driver.ino uses it:
+Serial with the << streaming operator and the _HEX, _BIN and _FLOAT formatters.
+Output goes to stdout, or nowhere when Serial.enabled is false.
+*/
+
+#ifndef MAX17263_HOST_ALBERT_h
+#define MAX17263_HOST_ALBERT_h
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#define F(s) (s)
+
+struct _HEX { unsigned long value; _HEX(unsigned long value) : value(value) {} };
+struct _BIN { unsigned long value; _BIN(unsigned long value) : value(value) {} };
+struct _FLOAT { double value; int digits; _FLOAT(double value, int digits) : value(value), digits(digits) {} };
+
+class HostSerial
+{
+public:
+  bool enabled = true;
+  void print(const char* s) { if(enabled) fputs(s, stdout); }
+};
+
+inline HostSerial Serial;
+
+inline HostSerial& operator<<(HostSerial& s, const char* v) { s.print(v); return s; }
+inline HostSerial& operator<<(HostSerial& s, char v) { char b[2] = {v, 0}; s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, bool v) { s.print(v ? "1" : "0"); return s; }
+inline HostSerial& operator<<(HostSerial& s, long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, int v) { return s << (long)v; }
+inline HostSerial& operator<<(HostSerial& s, unsigned v) { return s << (unsigned long)v; }
+inline HostSerial& operator<<(HostSerial& s, byte v) { return s << (unsigned long)v; }
+inline HostSerial& operator<<(HostSerial& s, uint16_t v) { return s << (unsigned long)v; }
+inline HostSerial& operator<<(HostSerial& s, double v) { char b[32]; snprintf(b, sizeof(b), "%.2f", v); s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, _FLOAT v) { char b[32]; snprintf(b, sizeof(b), "%.*f", v.digits, v.value); s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, _HEX v) { char b[24]; snprintf(b, sizeof(b), "%lX", v.value); s.print(b); return s; }
+inline HostSerial& operator<<(HostSerial& s, _BIN v)
+{ char b[40], *p = b + sizeof(b) - 1;
+  *p = 0;
+  do *--p = '0' + (v.value & 1); while(v.value >>= 1);
+  s.print(p);
+  return s;
+}
+
+#endif
@@ -0,0 +1,7 @@
+/*
+MIT License
+
+The sketch Arduino-MAX17263_Driver.ino implements the class declared in MAX17263.h
+*/
+
+#include "MAX17263.h"
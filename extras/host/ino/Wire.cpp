@@ -0,0 +1,44 @@
+/*
+MIT License
+
+Host TwoWire on a MAX17263Bus, see Wire.h
+*/
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::beginTransmission(byte address)
+{ this->address = address;
+  size = position = 0;
+  transmitting = true;
+}
+
+size_t TwoWire::write(byte data)
+{ if(!transmitting || size >= sizeof(buffer)) return 0;
+  buffer[size++] = data;
+  return 1;
+}
+
+byte TwoWire::endTransmission(bool stop)
+{ transmitting = false;
+  if(!bus || size == 0) return 2;
+  reg = buffer[0];
+  size_t words = (size - 1) / 2;
+  if(words == 0 && !stop) return 0; // register pointer for requestFrom()
+  uint16_t values[16];
+  for(size_t i = 0; i < words; i++) values[i] = buffer[1 + 2 * i] | buffer[2 + 2 * i] << 8;
+  return bus->writeRegs(address, reg, values, words) ? 0 : 2;
+}
+
+byte TwoWire::requestFrom(byte address, byte quantity)
+{ size = position = 0;
+  uint16_t values[16];
+  byte words = min(quantity / 2, 16);
+  if(!bus || !words || !bus->readRegs(address, reg, values, words)) return 0;
+  for(byte i = 0; i < words; i++)
+  { buffer[size++] = values[i] & 0xFF;
+    buffer[size++] = values[i] >> 8;
+  }
+  return size;
+}
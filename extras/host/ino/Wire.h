@@ -0,0 +1,35 @@
+/*
+MIT License
+
+Host Wire.h for compiling Arduino-MAX17263_Driver.ino on Linux: the TwoWire calls of the
+sketch are mapped onto a MAX17263Bus (simulator, i2c-dev or a trace recorder), so its
+transactions are the same as those of MAX17263.cpp on that bus.
+A transmission with only a register byte and no stop sets the register for requestFrom().
+*/
+
+#ifndef MAX17263_HOST_WIRE_h
+#define MAX17263_HOST_WIRE_h
+
+#include "MAX17263Bus.h"
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void beginTransmission(byte address);
+  size_t write(byte data);
+  byte endTransmission(bool stop = true); // 0 = ok, 2 = NAK like AVR Wire
+  byte requestFrom(byte address, byte quantity);
+  int available() { return size - position; }
+  int read() { return position < size ? buffer[position++] : -1; }
+
+  MAX17263Bus* bus = 0;
+
+private:
+  byte address, buffer[32], size = 0, position = 0, reg;
+  bool transmitting = false;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Compiles the characterisation data of a cell into a C++ header with a MAX17263CustomModel
+in PROGMEM, for MAX17263::customModel. The model checksum is computed here and checked
+again by the compiler (static_assert), the driver uses it to skip the upload when the chip
+already has the model.
+
+Input, INI or CSV, one register per line, ';' and '#' start a comment, [sections] are ignored:
+  RComp0 = 0x0070          named registers: RComp0, TempCo, QRTable00, QRTable10, QRTable20, QRTable30
+  0x80 = 0x9760            model table 0x80..0xAF, all 48 words are required
+  0x81,0xA510              CSV: register,value
+Other registers (DesignCap, IchgTerm, VEmpty, ModelCfg, ...) are listed in the header as a comment,
+they are set with the battery parameters of the driver.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. model_compiler.cpp -o model_compiler
+Usage:
+  model_compiler INPUT NAME [OUTPUT]   default OUTPUT is NAME.h
+*/
+
+#include "MAX17263.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+static const struct { const char* name; byte reg; } namedRegs[] =
+{ {"RComp0", 0x38}, {"TempCo", 0x39}, {"QRTable00", 0x12}, {"QRTable10", 0x22}, {"QRTable20", 0x32}, {"QRTable30", 0x42},
+  {"DesignCap", 0x18}, {"IchgTerm", 0x1E}, {"VEmpty", 0x3A}, {"ModelCfg", 0xDB}, {"FullCapRep", 0x10}, {"FullCapNom", 0x23},
+  {"LearnCfg", 0xA1}, {"RelaxCfg", 0xA0}, {"Config", 0x1D}, {"Config2", 0xBB}, {"FullSOCThr", 0x13}, {"HibCfg", 0xBA},
+};
+
+static std::string trim(const std::string& s)
+{ size_t begin = s.find_first_not_of(" \t\r\n\"");
+  size_t end = s.find_last_not_of(" \t\r\n\"");
+  return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+// Register from a name or a number, -1 if unknown
+static int parseRegister(const std::string& key)
+{ for(auto& r : namedRegs)
+    if(!strcasecmp(key.c_str(), r.name)) return r.reg;
+  char* end;
+  long reg = strtol(key.c_str(), &end, 0);
+  return *end || key.empty() || reg < 0 || reg > 0xFF ? -1 : reg;
+}
+
+static bool parseValue(const std::string& text, uint16_t& value)
+{ char* end;
+  long v = strtol(text.c_str(), &end, 0);
+  value = v;
+  return !text.empty() && !*end && v >= -32768 && v <= 0xFFFF;
+}
+
+static const char* registerName(byte reg)
+{ for(auto& r : namedRegs)
+    if(r.reg == reg) return r.name;
+  return 0;
+}
+
+int main(int argc, char** argv)
+{ if(argc < 3)
+  { fprintf(stderr, "usage: model_compiler INPUT NAME [OUTPUT], see model_compiler.cpp\n");
+    return 2;
+  }
+  const char* input = argv[1];
+  std::string name = argv[2], output = argc > 3 ? argv[3] : name + ".h";
+  FILE* in = fopen(input, "r");
+  if(!in) { fprintf(stderr, "cannot read %s\n", input); return 1; }
+
+  bool set[256] = {false};
+  uint16_t regs[256] = {0};
+  char line[256];
+  int lineNumber = 0, errors = 0;
+  while(fgets(line, sizeof(line), in))
+  { lineNumber++;
+    std::string s = line;
+    s = trim(s.substr(0, s.find_first_of(";#")));
+    if(s.empty() || s[0] == '[') continue;
+    size_t separator = s.find_first_of("=,");
+    if(separator == std::string::npos) continue;
+    std::string key = trim(s.substr(0, separator)), text = trim(s.substr(separator + 1));
+    int reg = parseRegister(key);
+    uint16_t value;
+    if(reg < 0 || !parseValue(text, value))
+    { if(lineNumber > 1) // a CSV header line is fine
+        fprintf(stderr, "%s:%d: ignored '%s'\n", input, lineNumber, s.c_str());
+      continue;
+    }
+    if(set[reg] && regs[reg] != value) fprintf(stderr, "%s:%d: register 0x%02X set twice\n", input, lineNumber, reg);
+    set[reg] = true;
+    regs[reg] = value;
+  }
+  fclose(in);
+
+  MAX17263CustomModel model;
+  for(byte i = 0; i < MAX17263_MODEL_SIZE; i++)
+  { if(!set[0x80 + i]) { fprintf(stderr, "%s: model table register 0x%02X missing\n", input, 0x80 + i); errors++; }
+    model.table[i] = regs[0x80 + i];
+  }
+  const byte characterisation[] = {0x38, 0x39, 0x12, 0x22, 0x32, 0x42};
+  for(byte reg : characterisation)
+    if(!set[reg]) { fprintf(stderr, "%s: %s missing\n", input, registerName(reg)); errors++; }
+  if(errors) return 1;
+  model.rComp0 = regs[0x38];
+  model.tempCo = regs[0x39];
+  for(byte i = 0; i < 4; i++) model.qrTable[i] = regs[0x12 + 0x10 * i];
+  model.checksum = MAX17263ModelChecksum(model.table, MAX17263_MODEL_SIZE);
+
+  FILE* out = fopen(output.c_str(), "w");
+  if(!out) { fprintf(stderr, "cannot write %s\n", output.c_str()); return 1; }
+  const char* base = strrchr(input, '/') ? strrchr(input, '/') + 1 : input;
+  fprintf(out, "/*\nCustom model %s for MAX17263::customModel, generated by extras/host/model_compiler from %s\n", name.c_str(), base);
+  fprintf(out, "Do not edit, change the characterisation data and generate it again.\n");
+  bool other = false;
+  for(int reg = 0; reg < 0x80; reg++)
+  { if(!set[reg] || reg == 0x38 || reg == 0x39 || reg == 0x12 || reg == 0x22 || reg == 0x32 || reg == 0x42) continue;
+    if(!other) fprintf(out, "\nNot part of the model, set with the battery parameters of the driver:\n");
+    other = true;
+    fprintf(out, "  %-10s (0x%02X) = 0x%04X\n", registerName(reg) ? registerName(reg) : "", reg, regs[reg]);
+  }
+  fprintf(out, "*/\n\n#ifndef %s_h\n#define %s_h\n\n#include \"MAX17263.h\"\n\n", name.c_str(), name.c_str());
+  fprintf(out, "constexpr MAX17263CustomModel %s PROGMEM =\n{ { // model table 0x80..0xAF\n", name.c_str());
+  for(byte i = 0; i < MAX17263_MODEL_SIZE; i++)
+    fprintf(out, "%s0x%04X%s", i % 8 ? " " : "    ", model.table[i], i + 1 == MAX17263_MODEL_SIZE ? "\n" : i % 8 == 7 ? ",\n" : ",");
+  fprintf(out, "  },\n  0x%04X, 0x%04X, // RComp0, TempCo\n", model.rComp0, model.tempCo);
+  fprintf(out, "  {0x%04X, 0x%04X, 0x%04X, 0x%04X}, // QRTable00..30\n", model.qrTable[0], model.qrTable[1], model.qrTable[2], model.qrTable[3]);
+  fprintf(out, "  0x%08XUL // checksum\n};\n\n", model.checksum);
+  fprintf(out, "static_assert(MAX17263ModelChecksum(%s.table, MAX17263_MODEL_SIZE) == %s.checksum, \"model table edited, generate it again\");\n\n#endif\n",
+          name.c_str(), name.c_str());
+  fclose(out);
+  printf("%s: model %s, checksum 0x%08X\n", output.c_str(), name.c_str(), model.checksum);
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Runs the driver against the simulator on a virtual clock (MAX17263VirtualClock.h): DAYS of
+operation in seconds of wall time. The sketch is MAX17263Sampler with the status check every 2s
+(initialize() after a POR) and a snapshot every 5.625s that saves the learned parameters when
+Cycles bit 2 toggles, every 0.64 cycles. The battery is discharged and charged at LOAD mA, 2 hours
+each, so Cycles counts up. Every POR_h hours the gauge gets a POR, alternately a brown-out (configuration
+kept) and a full power on reset. Checked after every initialize(): configuration read back,
+HibCfg restored after the hibernate exit; with every snapshot: the TimerH counted by the driver.
+The clock starts 100ms before millis() wraps around, the first FStat.DNR wait crosses the wrap.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. soak_test.cpp ../../MAX17263.cpp ../../MAX17263Sampler.cpp \
+      ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp -o soak_test
+Usage:
+  soak_test [DAYS] [POR_h] [LOAD_mA]   default 30 24 1500
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sampler.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+struct Soak
+{ MAX17263VirtualClock clock{(0x100000000ULL - 100) * 1000}; // millis() wraps during the first DNR wait
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+  MAX17263LearnedParams params;
+  uint32_t initializations = 0, configErrors = 0, hibCfgErrors = 0, saves = 0, batteryMissing = 0, timerHErrors = 0;
+};
+
+static void checkStatus(bool batteryPresent, bool initialized, void *context)
+{ Soak& s = *(Soak*)context;
+  s.batteryMissing += !batteryPresent;
+  if(!initialized) return;
+  s.initializations++;
+  s.configErrors += !s.gauge.configVerified;
+  s.hibCfgErrors += s.sim.regs[0xBA] != 0x870C;
+}
+
+static void saveLearned(const MAX17263Snapshot &snapshot, void *context)
+{ Soak& s = *(Soak*)context;
+  // TimerH of the snapshot is counted by the driver, it must follow roll overs and restart at a POR
+  s.timerHErrors += snapshot.timerH != s.sim.regs[0xBE] && s.sim.regs[0x3E] >= snapshot.timer;
+  if(s.gauge.learnedParamsDue() && s.gauge.saveLearnedParams(s.params)) s.saves++;
+}
+
+int main(int argc, char** argv)
+{ double days = argc > 1 ? atof(argv[1]) : 30;
+  double por_h = argc > 2 ? atof(argv[2]) : 24;
+  float load_mA = argc > 3 ? atof(argv[3]) : 1500;
+  Soak s;
+  s.gauge.begin(s.bus, s.clock);
+  s.gauge.rSense = 0.01;
+  s.gauge.designCap_mAh = 3000;
+  s.gauge.modelID = 0;
+  s.gauge.vEmpty = 3.3;
+  s.gauge.ichgTerm = 0x0640;
+  MAX17263Sampler sampler(s.gauge, s.clock);
+  sampler.everyStatus(2000, checkStatus, &s);
+  sampler.everySnapshot(5625, saveLearned, &s);
+
+  const uint64_t hour_us = 3600000000ULL;
+  uint64_t start_us = s.clock.now_us, end_us = start_us + (uint64_t)(days * 24 * hour_us);
+  uint64_t nextPOR_us = start_us + (uint64_t)(por_h * hour_us);
+  uint32_t pors = 1, cycles = 0, toggles = 0; // the simulator starts with a POR
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  while(s.clock.now_us < end_us)
+  { s.sim.current_mA = (s.clock.now_us - start_us) / (2 * hour_us) % 2 ? load_mA : -load_mA;
+    if(s.clock.now_us >= nextPOR_us)
+    { if(pors % 2) s.sim.warmReset();
+      else
+      { cycles += s.sim.regs[0x17];
+        toggles += s.sim.regs[0x17] / 4; // Cycles restarts at 0
+        s.sim.powerOnReset();
+      }
+      pors++;
+      nextPOR_us += (uint64_t)(por_h * hour_us);
+      MAX17263Snapshot snapshot; // before the status check sees the POR, Timer went back without a roll over
+      if(s.gauge.readSnapshot(snapshot)) saveLearned(snapshot, &s);
+    }
+    uint32_t wait_ms = sampler.run();
+    s.clock.advance_ms(wait_ms ? wait_ms : 1);
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  cycles += s.sim.regs[0x17];
+  toggles += s.sim.regs[0x17] / 4;
+
+  double virtual_s = (s.clock.now_us - start_us) / 1e6;
+  printf("%.1f virtual days in %.2f s wall time, %.0fx real time\n", virtual_s / 86400, wall_s, virtual_s / wall_s);
+  printf("POR %u, initialize() %u, configuration errors %u, HibCfg not restored %u, battery missing %u\n",
+         pors, s.initializations, s.configErrors, s.hibCfgErrors, s.batteryMissing);
+  // One save per toggle of Cycles bit 2, after a POR one more when the saved bit 2 was set
+  bool savesOK = s.saves >= toggles && s.saves <= toggles + pors;
+  printf("%.2f cycles, learned parameters saved %u times for %u toggles of Cycles bit 2 (every 0.64 cycles)%s\n",
+         cycles * MAX17263RegCycles::lsb(), s.saves, toggles, savesOK ? "" : " ERROR");
+  printf("TimerH of the snapshots wrong %u times\n", s.timerHErrors);
+  printf("%u bus transactions, %.1f s wire time, read errors %u\n", s.bus.transactions, s.bus.wireTime_us / 1e6,
+         s.gauge.busStats.readErrors);
+  return s.initializations == pors && !s.configErrors && !s.hibCfgErrors && !s.timerHErrors && savesOK ? 0 : 1;
+}
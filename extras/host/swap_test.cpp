@@ -0,0 +1,185 @@
+/*
+MIT License
+
+Battery hot-swap on the simulator: the battery is removed for a second and a pack with a
+different charge is inserted, the gauge stays powered (Status.BI without POR). Measured is the
+time from the insertion until the application reads a valid SOC, the SOC of the new pack.
+The sketch checks the status every POLL ms and reads the SOC every second and right after a
+(re)initialization, on a virtual clock. With ALRT the Config.Bei/Ber alert of the gauge
+triggers the status check at once, the poll stays as the fallback.
+
+  poll, POR only   the status check before the swap handling: initialize() after a POR only,
+                   the gauge keeps the SOC of the old pack (the simulator keeps it for ever)
+  poll             reinitializeAfterSwap() after Status.BI
+  ALRT             the same, triggered by the ALRT pin
+  gauge reset too  the gauge lost its power with the battery, POR: the full initialize(), ALRT
+                   is off until the configuration is written again, so the poll finds it
+  MAX17263Sampler  the status task of the sampler, sampler.alert() from the ALRT edge
+
+Times in ms from the insertion: detect is the status check that starts the (re)initialization,
+reinit its duration, valid the first SOC read within 1% of the new pack. Transactions are those
+from the insertion until valid, poll load the transactions per second of the sketch before the swap.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. swap_test.cpp ../../MAX17263.cpp ../../MAX17263Sampler.cpp ../../MAX17263Clock.cpp \
+      Arduino.cpp MAX17263Sim.cpp -o swap_test
+Usage:
+  swap_test [OLD_V] [NEW_V]   default 3.9 3.5, the voltages of the packs (3.0V = 0%, 4.2V = 100%)
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sampler.h"
+#include "MAX17263Sim.h"
+#include "MAX17263VirtualClock.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+struct Mode
+{ const char* name;
+  uint32_t poll_ms;
+  bool swapHandling, alrt, porToo, sampler;
+};
+
+static const Mode modes[] = {
+  {"poll 2s, POR only",     2000, false, false, false, false},
+  {"poll 2s",               2000, true,  false, false, false},
+  {"poll 250ms",             250, true,  false, false, false},
+  {"ALRT",                  2000, true,  true,  false, false},
+  {"ALRT, gauge reset too", 2000, true,  true,  true,  false},
+  {"MAX17263Sampler, ALRT", 2000, true,  true,  false, true},
+};
+
+struct Rig
+{ MAX17263VirtualClock clock;
+  MAX17263Sim sim{clock};
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+  MAX17263Sampler sampler{gauge, clock};
+  float newSOC = 0;
+  bool inserted = false;
+  int64_t insert_ms = 0, detect_ms = -1, valid_ms = -1;
+  uint16_t reinit_ms = 0;
+
+  void readSOC()
+  { float soc = gauge.getSOC();
+    if(inserted && valid_ms < 0 && fabs(soc - newSOC) < 1) valid_ms = clock.millis() - insert_ms;
+  }
+  void reinitialized(uint32_t start, bool swap)
+  { if(!inserted || detect_ms >= 0) return;
+    detect_ms = start - insert_ms;
+    reinit_ms = swap ? gauge.reinitialize_ms : gauge.initialize_ms;
+  }
+};
+
+// The status check of the sketch, without the sampler
+static void checkStatus(Rig& r, const Mode& m)
+{ uint32_t start = r.clock.millis();
+  bool present = r.gauge.batteryPresent();
+  if(present && r.gauge.powerOnResetEvent())
+  { r.gauge.initialize();
+    r.reinitialized(start, false);
+    r.readSOC();
+  }
+  else if(present && m.swapHandling && r.gauge.batterySwapEvent())
+  { r.gauge.reinitializeAfterSwap();
+    r.reinitialized(start, true);
+    r.readSOC();
+  }
+  else if(!present) r.gauge.clearBatteryRemoval(); // releases ALRT for the insertion
+}
+
+static void onSnapshot(const MAX17263Snapshot &snapshot, void *context)
+{ ((Rig*)context)->readSOC();
+}
+
+static void onStatus(bool batteryPresent, bool initialized, void *context)
+{ Rig& r = *(Rig*)context;
+  if(!initialized) return;
+  r.reinitialized(r.clock.millis() - (r.sampler.swaps ? r.gauge.reinitialize_ms : r.gauge.initialize_ms), r.sampler.swaps);
+  r.readSOC();
+}
+
+static bool run(const Mode& m, float oldV, float newV)
+{ Rig r;
+  r.sim.battery_V = oldV;
+  r.gauge.begin(r.bus, r.clock);
+  r.gauge.rSense = 0.01;
+  r.gauge.designCap_mAh = 3000;
+  r.gauge.modelID = 0;
+  r.gauge.vEmpty = 3.3;
+  r.gauge.ichgTerm = 0x0640;
+  r.gauge.swapAlert = m.alrt;
+  r.newSOC = (newV - 3.0) / 1.2 * 100;
+  if(m.sampler)
+  { r.sampler.everySnapshot(1000, onSnapshot, &r);
+    r.sampler.everyStatus(m.poll_ms, onStatus, &r);
+  }
+
+  const uint32_t settle_ms = 10000, remove_ms = 20337, insert_ms = remove_ms + 1000, limit_ms = 60000; // off the grid
+  uint32_t nextPoll = 0, nextRead = 0, baseline = 0, transactions = 0;
+  bool removed = false, line = false, alert = false;
+  while(true)
+  { uint32_t now = r.clock.millis();
+    if(now == settle_ms) baseline = r.bus.transactions;
+    if(!removed && now >= remove_ms)
+    { baseline = r.bus.transactions - baseline;
+      removed = true;
+      r.sim.batteryPresent = false;
+    }
+    if(!r.inserted && now >= insert_ms)
+    { r.inserted = true;
+      r.insert_ms = now;
+      transactions = r.bus.transactions;
+      r.sim.battery_V = newV;
+      r.sim.batteryPresent = true;
+      if(m.porToo) r.sim.powerOnReset();
+    }
+    bool level = r.sim.alert(); // the interrupt on the falling edge of ALRT
+    alert |= m.alrt && level && !line;
+    line = level;
+    uint32_t wait;
+    if(m.sampler)
+    { if(alert) r.sampler.alert();
+      alert = false;
+      wait = r.sampler.run();
+    }
+    else
+    { if(alert || (int32_t)(now - nextPoll) >= 0)
+      { if(!alert) nextPoll += m.poll_ms;
+        alert = false;
+        checkStatus(r, m);
+      }
+      if((int32_t)(r.clock.millis() - nextRead) >= 0)
+      { nextRead += 1000;
+        r.readSOC();
+      }
+      int32_t poll = nextPoll - r.clock.millis(), read = nextRead - r.clock.millis();
+      wait = poll < read ? poll : read;
+      wait = (int32_t)wait > 0 ? wait : 0;
+    }
+    uint32_t after = r.clock.millis();
+    if(r.valid_ms >= 0 || (r.inserted && after - r.insert_ms > limit_ms)) break;
+    uint32_t event = after < settle_ms ? settle_ms : !removed ? remove_ms : !r.inserted ? insert_ms : 0;
+    if(event && event - after < wait) wait = event - after;
+    r.clock.advance_ms(wait ? wait : 1);
+  }
+  char detect[24], valid[24];
+  if(r.detect_ms >= 0) snprintf(detect, sizeof detect, "%lld", (long long)r.detect_ms);
+  else snprintf(detect, sizeof detect, "never");
+  if(r.valid_ms >= 0) snprintf(valid, sizeof valid, "%lld", (long long)r.valid_ms);
+  else snprintf(valid, sizeof valid, "stale");
+  printf("%-22s %7s %7u %7s %13u %10.2f  %s\n", m.name, detect, r.reinit_ms, valid, r.bus.transactions - transactions,
+         baseline * 1000.0 / (remove_ms - settle_ms), r.gauge.fault == faultNone ? "" : "fault left");
+  return r.valid_ms >= 0 || !m.swapHandling;
+}
+
+int main(int argc, char** argv)
+{ float oldV = argc > 1 ? atof(argv[1]) : 3.9, newV = argc > 2 ? atof(argv[2]) : 3.5;
+  printf("swap %.2fV (%.0f%%) -> %.2fV (%.0f%%), times in ms from the insertion\n", oldV, (oldV - 3.0) / 1.2 * 100,
+         newV, (newV - 3.0) / 1.2 * 100);
+  printf("%-22s %7s %7s %7s %13s %10s\n", "status check", "detect", "reinit", "valid", "transactions", "poll tx/s");
+  bool ok = true;
+  for(const Mode& m : modes) ok &= run(m, oldV, newV);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Rebuilds the time line of chip-timer-tagged snapshots (MAX17263Timeline.h): the exact
+spacing of the samples, duplicate reads of one conversion, POR of a gauge and the alignment
+of several gauges, from a CSV log "gauge,time_ms,timer,timerH" of MAX17263Snapshot.
+
+Build:
+  g++ -O2 -std=c++17 -I. -I../.. timeline_tool.cpp MAX17263Timeline.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp Arduino.cpp \
+      MAX17263Sim.cpp -o timeline_tool
+Usage:
+  timeline_tool sim FILE [GAUGES] [SAMPLES] [PERIOD_ms]   log simulated gauges, a loop with delay(PERIOD_ms)
+                                                           after a variable amount of work, default 4 40 100
+  timeline_tool show FILE                                  every sample with chip time, spacing and aligned time
+  timeline_tool check FILE                                 per gauge: duplicates, POR, chip clock rate, MCU jitter
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Sim.h"
+#include "MAX17263Timeline.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+struct SimGauge
+{ MAX17263Sim sim;
+  MAX17263SimBus bus{sim};
+  MAX17263 gauge;
+};
+
+static int simulate(const char* path, int n, int samples, uint32_t period_ms)
+{ FILE* f = fopen(path, "w");
+  if(!f) { fprintf(stderr, "cannot write %s\n", path); return 1; }
+  std::vector<std::unique_ptr<SimGauge>> gauges;
+  for(int i = 0; i < n; i++)
+  { gauges.emplace_back(new SimGauge);
+    SimGauge& g = *gauges.back();
+    g.sim.timerError_ppm = 1000.0 * (i - n / 2); // exaggerated, so it shows in a short log
+    g.bus.sleepWireTime = false;
+    g.gauge.begin(g.bus);
+    delay(37); // powered up one after the other, each Timer has its own offset
+  }
+  std::mt19937 random(1);
+  fprintf(f, "# gauge,time_ms,timer,timerH, %d simulated gauges, delay(%u) loop\n", n, period_ms);
+  for(int k = 0; k < samples; k++)
+  { for(int i = 0; i < n; i++)
+    { MAX17263Snapshot snapshot;
+      if(!gauges[i]->gauge.readSnapshot(snapshot)) continue;
+      fprintf(f, "%d,%u,%u,%u\n", i, snapshot.time_ms, snapshot.timer, snapshot.timerH);
+    }
+    delay(random() % (period_ms / 2 + 1)); // work of the loop, varies
+    delay(period_ms);
+  }
+  fclose(f);
+  printf("%d samples of %d gauges written to %s\n", samples * n, n, path);
+  return 0;
+}
+
+static bool analyse(const char* path, std::vector<MAX17263TimedSample>& samples, std::map<int, MAX17263GaugeTiming>& gauges)
+{ if(!loadTimeline(samples, path) || samples.empty()) { fprintf(stderr, "cannot read %s\n", path); return false; }
+  MAX17263AnalyseTimeline(samples, gauges);
+  return true;
+}
+
+static int show(const char* path)
+{ std::vector<MAX17263TimedSample> samples;
+  std::map<int, MAX17263GaugeTiming> gauges;
+  if(!analyse(path, samples, gauges)) return 1;
+  printf("gauge,time_ms,timer,timerH,epoch,chip_s,spacing_s,aligned_ms,duplicate\n");
+  for(const MAX17263TimedSample& s : samples)
+  { printTimedSample(stdout, s);
+    printf(",%d,%.4f,%.4f,%.1f,%d\n", s.epoch, s.chip_s, s.spacing_s, s.aligned_ms, s.duplicate);
+  }
+  return 0;
+}
+
+static int check(const char* path)
+{ std::vector<MAX17263TimedSample> samples;
+  std::map<int, MAX17263GaugeTiming> gauges;
+  if(!analyse(path, samples, gauges)) return 1;
+  for(auto& g : gauges)
+    printf("gauge %d: %d samples, %d duplicate reads, %d POR, chip clock %+.0f +-%.0f ppm, "
+           "MCU timestamps %.1f ms rms from the chip time line, worst spacing error %.1f ms\n",
+           g.first, g.second.samples, g.second.duplicates, g.second.resets, g.second.rate_ppm,
+           g.second.rateResolution_ppm, g.second.jitter_ms, g.second.maxSpacingError_ms);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{ if(argc >= 3 && !strcmp(argv[1], "sim"))
+    return simulate(argv[2], argc > 3 ? atoi(argv[3]) : 4, argc > 4 ? atoi(argv[4]) : 40, argc > 5 ? atoi(argv[5]) : 100);
+  if(argc >= 3 && !strcmp(argv[1], "show")) return show(argv[2]);
+  if(argc >= 3 && !strcmp(argv[1], "check")) return check(argv[2]);
+  fprintf(stderr, "usage: timeline_tool sim|show|check ..., see timeline_tool.cpp\n");
+  return 2;
+}
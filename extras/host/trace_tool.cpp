@@ -0,0 +1,194 @@
+/*
+MIT License
+
+Records, replays, prints and compares bus traces (MAX17263Trace.h).
+The scenario is batteryPresent(), initialize() and SAMPLES rounds of the getters
+(SOC, VCell, Current, Temp, Capacity, TimeToEmpty), on the simulator or on hardware.
+
+Build with the library (MAX17263.cpp):
+  g++ -O2 -std=c++17 -I. -I../.. trace_tool.cpp MAX17263Trace.cpp ../../MAX17263.cpp ../../MAX17263Clock.cpp Arduino.cpp \
+      MAX17263Sim.cpp MAX17263LinuxI2C.cpp -o trace_tool
+Build with the sketch (Arduino-MAX17263_Driver.ino, Wire and Serial from extras/host/ino):
+  g++ -O2 -std=c++17 -DMAX17263_TRACE_INO -I. -Iino -I../.. trace_tool.cpp MAX17263Trace.cpp \
+      -x c++ ../../Arduino-MAX17263_Driver.ino -x none ino/Wire.cpp ../../MAX17263Clock.cpp Arduino.cpp MAX17263Sim.cpp \
+      MAX17263LinuxI2C.cpp -o trace_tool_ino
+Usage:
+  trace_tool record FILE [SAMPLES] [--dev /dev/i2c-N] [--serial]   record the scenario, simulator by default
+  trace_tool replay FILE [SAMPLES] [RUNS]                         replay the scenario RUNS times against FILE
+  trace_tool dump FILE                                            print the transactions
+  trace_tool diff FILE1 FILE2                                     transactions that differ, e.g.
+                                                                  trace_tool diff lib.trc ino.trc
+Replaying a trace of the other build shows where the driver code diverges from the recording.
+A replay runs on a MAX17263VirtualClock, the delays of the driver (e.g. the FStat.DNR poll) do not
+wait: the CPU time per run is measured, the driver time (virtual time incl. delays) is reported apart.
+*/
+
+#include "MAX17263.h"
+#include "MAX17263Trace.h"
+#include "MAX17263Sim.h"
+#include "MAX17263LinuxI2C.h"
+#include "MAX17263VirtualClock.h"
+#ifdef MAX17263_TRACE_INO
+#include <Wire.h>
+#include <Albert.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+static void attach(MAX17263& gauge, MAX17263Bus& bus, MAX17263Clock* clock = 0) // 0: the system clock
+{
+#ifdef MAX17263_TRACE_INO
+  Wire.bus = &bus;
+  setArduinoClock(clock); // the sketch calls millis() and delay() itself
+#else
+  gauge.begin(bus, clock ? *clock : MAX17263System);
+#endif
+}
+
+static void runScenario(MAX17263& gauge, int samples)
+{ gauge.rSense = 0.01;
+  gauge.designCap_mAh = 3000;
+  gauge.r100 = 0;
+  gauge.vChg = 0;
+  gauge.modelID = 0;
+  gauge.ichgTerm = 0x0640;
+  gauge.vEmpty = 3.3;
+  gauge.batteryPresent();
+  gauge.initialize();
+  volatile float sink = 0;
+  for(int i = 0; i < samples; i++)
+    sink = sink + gauge.getSOC() + gauge.getVcell() + gauge.getCurrent() + gauge.getTemp()
+                + gauge.getCapacity_mAh() + gauge.getTimeToEmpty();
+}
+
+static int record(const char* path, int samples, const char* device)
+{ MAX17263Sim sim;
+  MAX17263SimBus simBus(sim);
+  std::optional<MAX17263LinuxI2C> adapter;
+  MAX17263Bus* bus = &simBus;
+  if(device)
+  { adapter.emplace(device);
+    if(!adapter->isOpen()) { fprintf(stderr, "cannot open %s\n", device); return 1; }
+    bus = &*adapter;
+  }
+  MAX17263TraceRecorder recorder(*bus);
+  MAX17263 gauge;
+  attach(gauge, recorder);
+  runScenario(gauge, samples);
+  if(!saveTrace(recorder.trace, path)) { fprintf(stderr, "cannot write %s\n", path); return 1; }
+  printf("%zu transactions, %u us recorded in %s\n", recorder.trace.size(),
+         recorder.trace.empty() ? 0 : recorder.trace.back().time_us, path);
+  return 0;
+}
+
+static int replay(const char* path, int samples, int runs)
+{ MAX17263Trace trace;
+  if(!loadTrace(trace, path)) { fprintf(stderr, "cannot read %s\n", path); return 1; }
+  MAX17263TraceReplay bus(trace);
+  std::vector<double> times_us;
+  uint64_t driver_us = 0;
+  for(int run = 0; run < runs; run++)
+  { bus.rewind();
+    MAX17263VirtualClock clock;
+    MAX17263 gauge;
+    attach(gauge, bus, &clock);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    runScenario(gauge, samples);
+    times_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    driver_us = clock.now_us;
+  }
+#ifdef MAX17263_TRACE_INO
+  setArduinoClock(0); // the clock of the last run is gone
+#endif
+  std::sort(times_us.begin(), times_us.end());
+  printf("%d runs of %zu transactions, CPU time: min %.1f us, median %.1f us, max %.1f us\n", runs, trace.size(),
+         times_us.front(), times_us[times_us.size() / 2], times_us.back());
+  printf("driver time per run %llu us (delays of the virtual clock), recorded %u us\n", (unsigned long long)driver_us,
+         trace.empty() ? 0 : trace.back().time_us);
+  printf("last run: %u transfers, %u records skipped, %u divergences, %u write mismatches, %s\n",
+         bus.transfers, bus.skipped, bus.divergences, bus.writeMismatches,
+         bus.finished() ? "trace finished" : "trace not finished");
+  return bus.divergences || bus.writeMismatches || !bus.finished();
+}
+
+static int dump(const char* path)
+{ MAX17263Trace trace;
+  if(!loadTrace(trace, path)) { fprintf(stderr, "cannot read %s\n", path); return 1; }
+  for(const MAX17263TraceRecord& r : trace)
+  { printf("%10u us  ", r.time_us);
+    printRecord(stdout, r);
+    printf("\n");
+  }
+  return 0;
+}
+
+// Reads are equal when they address the same registers, writes when they also write the same words
+static bool sameTransaction(const MAX17263TraceRecord& a, const MAX17263TraceRecord& b)
+{ return a.sameTransfer(b) && (!a.write || a.values == b.values);
+}
+
+// Longest common subsequence of the two traces, printed as a unified diff
+static int diff(const char* path1, const char* path2)
+{ MAX17263Trace a, b;
+  if(!loadTrace(a, path1)) { fprintf(stderr, "cannot read %s\n", path1); return 1; }
+  if(!loadTrace(b, path2)) { fprintf(stderr, "cannot read %s\n", path2); return 1; }
+  size_t n = a.size(), m = b.size();
+  std::vector<uint32_t> lcs((n + 1) * (m + 1), 0);
+  for(size_t i = n; i-- > 0;)
+    for(size_t j = m; j-- > 0;)
+      lcs[i * (m + 1) + j] = sameTransaction(a[i], b[j]) ? lcs[(i + 1) * (m + 1) + j + 1] + 1
+                           : std::max(lcs[(i + 1) * (m + 1) + j], lcs[i * (m + 1) + j + 1]);
+  printf("--- %s (%zu transactions)\n+++ %s (%zu transactions)\n", path1, n, path2, m);
+  size_t i = 0, j = 0, removed = 0, added = 0;
+  while(i < n || j < m)
+  { if(i < n && j < m && sameTransaction(a[i], b[j]))
+    { printf("  ");
+      printRecord(stdout, a[i]);
+      if(a[i].values != b[j].values)
+      { printf("  ->");
+        for(uint16_t v : b[j].values) printf(" 0x%04X", v);
+      }
+      i++, j++;
+    }
+    else if(j < m && (i == n || lcs[i * (m + 1) + j + 1] >= lcs[(i + 1) * (m + 1) + j]))
+    { printf("+ ");
+      printRecord(stdout, b[j++]);
+      added++;
+    }
+    else
+    { printf("- ");
+      printRecord(stdout, a[i++]);
+      removed++;
+    }
+    printf("\n");
+  }
+  printf("%zu removed, %zu added\n", removed, added);
+  return removed || added;
+}
+
+int main(int argc, char** argv)
+{ const char* device = 0;
+  std::vector<const char*> args;
+#ifdef MAX17263_TRACE_INO
+  Serial.enabled = false; // the sketch logs every step
+#endif
+  for(int i = 1; i < argc; i++)
+  { if(!strcmp(argv[i], "--dev") && i + 1 < argc) device = argv[++i];
+#ifdef MAX17263_TRACE_INO
+    else if(!strcmp(argv[i], "--serial")) Serial.enabled = true;
+#endif
+    else args.push_back(argv[i]);
+  }
+  if(args.size() >= 2 && !strcmp(args[0], "record")) return record(args[1], args.size() > 2 ? atoi(args[2]) : 10, device);
+  if(args.size() >= 2 && !strcmp(args[0], "replay"))
+    return replay(args[1], args.size() > 2 ? atoi(args[2]) : 10, args.size() > 3 ? atoi(args[3]) : 100);
+  if(args.size() >= 2 && !strcmp(args[0], "dump")) return dump(args[1]);
+  if(args.size() >= 3 && !strcmp(args[0], "diff")) return diff(args[1], args[2]);
+  fprintf(stderr, "usage: trace_tool record|replay|dump|diff ..., see trace_tool.cpp\n");
+  return 2;
+}